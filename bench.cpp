@@ -0,0 +1,827 @@
+// Description: Microbenchmarks for the demand paging simulator. Prints one
+// CSV row per case: ns/op and ops/sec, where an op is the unit named in the
+// last column.
+//
+// Compile: g++ bench.cpp engine.cpp paging.cpp -std=c++20 -pthread -O2
+//          -o bench
+// Usage: ./bench [--perf] [name filter]
+//        ./bench --save-baseline FILE
+//        ./bench --compare FILE [--threshold PERCENT]
+//        ./bench --scaling
+//
+// --perf adds hardware counters per op (cycles, instructions, LLC, dTLB and
+// branch misses) as extra columns, left empty where they are unavailable.
+//
+// --save-baseline runs a fixed suite of seeded workloads several times and
+// stores the median and MAD of each; --compare reruns the suite and flags
+// throughput or fault-ratio regressions against the stored baseline.
+//
+// --scaling grows frames, jobs, pages and accesses geometrically and prints
+// time per access, memory per page and the empirical growth exponent of
+// each policy.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "engine.h"
+#include "paging.h"
+
+using namespace std;
+
+// Keeps the compiler from discarding a benchmarked result
+template <class T> void doNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchResult {
+  string name;
+  string param;
+  long iterations{};
+  double nsPerOp{};
+  string unit;
+  PerfSample perf;
+};
+
+// Minimum measured time per case
+const double BENCH_MIN_SECONDS = 0.2;
+
+const char *benchFilter = nullptr;
+
+bool benchSelected(const string &name) {
+  return !benchFilter || name.find(benchFilter) != string::npos;
+}
+
+void printBenchResult(const BenchResult &r) {
+  printf("%s,%s,%ld,%.2f,%.0f,%s", r.name.c_str(), r.param.c_str(),
+         r.iterations, r.nsPerOp, r.nsPerOp > 0 ? 1e9 / r.nsPerOp : 0,
+         r.unit.c_str());
+  if (perfCountersEnabled)
+    for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+      if (r.perf.valid[i])
+        printf(",%.3f", (double)r.perf.values[i] / r.iterations);
+      else
+        printf(",");
+    }
+  printf("\n");
+  fflush(stdout);
+}
+
+// Runs op(n), which performs at least n ops and returns how many it did, in
+// growing batches until the batch takes at least BENCH_MIN_SECONDS, and
+// reports the time per op of that batch
+template <class F>
+void runBench(const string &name, const string &param, const string &unit,
+              F op) {
+  if (!benchSelected(name))
+    return;
+  PerfCounters counters;
+  long n = 1;
+  for (;;) {
+    counters.start();
+    auto start = chrono::steady_clock::now();
+    long done = op(n);
+    double seconds =
+        chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    auto perf = counters.stop();
+    if (seconds >= BENCH_MIN_SECONDS || n >= (1L << 40)) {
+      printBenchResult({name, param, done, seconds * 1e9 / done, unit, perf});
+      return;
+    }
+    // Aim a little past the minimum so the next batch is usually the last
+    n = seconds > 0 ? max(n * 2, (long)(n * 1.2 * BENCH_MIN_SECONDS / seconds))
+                    : n * 100;
+  }
+}
+
+// Jobs of pagesPerJob full pages each
+vector<Job> benchJobs(int numJobs, int pagesPerJob, int pageSize) {
+  vector<Job> jobs(numJobs);
+  for (int j = 0; j < numJobs; j++) {
+    jobs[j].id = j;
+    jobs[j].size = pagesPerJob * pageSize;
+  }
+  return jobs;
+}
+
+// Loads every page of every job into the engine (frames must suffice)
+void loadAllPages(DemandPagingEngine &e) {
+  for (auto &kv : e.JT)
+    for (auto &pkv : kv.second.PMT)
+      engineAccess(e, kv.first, pkv.first);
+}
+
+// Next page at or after the cursor that is not in memory
+Access nextNonResident(JobTable &JT, const vector<Access> &allPages,
+                       size_t &cursor) {
+  for (;;) {
+    const auto &a = allPages[cursor];
+    cursor = (cursor + 1) % allPages.size();
+    if (!JT[a.jobId].PMT[a.pageNumber].inMemory)
+      return a;
+  }
+}
+
+// Every page of every job, in job then page order
+vector<Access> allPagesOf(const JobTable &JT) {
+  vector<Access> res;
+  for (const auto &kv : JT)
+    for (const auto &pkv : kv.second.PMT)
+      res.push_back({kv.first, pkv.first});
+  return res;
+}
+
+void benchDivideIntoPages() {
+  const int pageSize = 4;
+  for (int pages : {16, 256, 4096}) {
+    Job j{0, pages * pageSize};
+    runBench("divideIntoPages", to_string(pages) + " pages", "call",
+             [&](long n) {
+               for (long i = 0; i < n; i++)
+                 doNotOptimize(divideIntoPages(j, pageSize));
+               return n;
+             });
+  }
+}
+
+// A job of the given number of pages, all resident in frames in reverse
+// order, and 4096 seeded random logical addresses into it
+struct TranslateSetup {
+  PageMapTable PMT;
+  MainMemory ram;
+  vector<int> addrs;
+};
+
+TranslateSetup makeTranslateSetup(int pages, int pageSize) {
+  TranslateSetup t;
+  t.PMT = divideIntoPages(Job{0, pages * pageSize}, pageSize).second;
+  t.ram.resize(pages);
+  for (int i = 0; i < pages; i++) {
+    t.ram[i].id = i;
+    t.ram[i].size = pageSize;
+    t.ram[i].startingAddr = i * pageSize;
+    t.PMT[i].pageFrameId = pages - 1 - i;
+    t.PMT[i].inMemory = true;
+  }
+
+  mt19937 gen(1);
+  uniform_int_distribution<> addrDist(0, pages * pageSize - 1);
+  t.addrs.resize(4096);
+  for (auto &addr : t.addrs)
+    addr = addrDist(gen);
+  return t;
+}
+
+void benchTranslate() {
+  const int pageSize = 4096;
+  for (int pages : {16, 1024, 65536}) {
+    auto setup = makeTranslateSetup(pages, pageSize);
+    auto &PMT = setup.PMT;
+    auto &ram = setup.ram;
+    auto &addrs = setup.addrs;
+
+    runBench("translateAddress", to_string(pages) + " pages", "translation",
+             [&](long n) {
+               for (long i = 0; i < n; i++)
+                 doNotOptimize(
+                     translateAddress(PMT, ram, addrs[i & 4095], pageSize));
+               return n;
+             });
+  }
+}
+
+// Every page resident, so each access is a hit. Under FIFO there is no aging,
+// so this is the bare hit path; LRU adds the aging pass of every access.
+void benchHitPath() {
+  const int pageSize = 4;
+  for (int frames : {16, 256, 4096}) {
+    auto jobs = benchJobs(4, frames / 4, pageSize);
+    for (auto policy : {ReplacementPolicy::Fifo, ReplacementPolicy::Lru}) {
+      string name = string("hit/") + policyName(policy);
+      if (!benchSelected(name))
+        continue;
+      DemandPagingEngine e;
+      initEngine(e, frames, pageSize, jobs, policy, false);
+      loadAllPages(e);
+      auto trace = generateTrace(pagesPerJob(4, pageSize, jobs), 4096, 1);
+
+      runBench(name, to_string(frames) + " frames", "access", [&](long n) {
+        for (long i = 0; i < n; i++)
+          engineAccess(e, trace[i & 4095].jobId, trace[i & 4095].pageNumber);
+        return n;
+      });
+    }
+  }
+}
+
+void benchAging() {
+  const int pageSize = 4;
+  for (int frames : {16, 256, 4096}) {
+    auto jobs = benchJobs(4, frames / 4, pageSize);
+    DemandPagingEngine e;
+    initEngine(e, frames, pageSize, jobs, ReplacementPolicy::Lru, false);
+    loadAllPages(e);
+    runBench("ageReferencedBits", to_string(frames) + " resident pages",
+             "access", [&](long n) {
+               for (long i = 0; i < n; i++)
+                 ageReferencedBits(e.JT);
+               doNotOptimize(e.JT);
+               return n;
+             });
+  }
+}
+
+// Memory full, with twice as many pages as frames; every op evicts a victim
+// to load a page that is not in memory
+void benchEviction() {
+  const int pageSize = 4;
+  for (int frames : {16, 256, 4096}) {
+    auto jobs = benchJobs(4, frames / 2, pageSize);
+    for (auto policy : {ReplacementPolicy::Fifo, ReplacementPolicy::Lru}) {
+      string name = policy == ReplacementPolicy::Fifo ? "FIFO" : "LRU";
+      if (!benchSelected(name))
+        continue;
+      DemandPagingEngine e;
+      initEngine(e, frames, pageSize, jobs, policy, false);
+      auto allPages = allPagesOf(e.JT);
+      for (int i = 0; i < frames; i++)
+        engineAccess(e, allPages[i].jobId, allPages[i].pageNumber);
+      size_t cursor = frames;
+
+      runBench(name, to_string(frames) + " frames", "eviction", [&](long n) {
+        for (long i = 0; i < n; i++) {
+          auto a = nextNonResident(e.JT, allPages, cursor);
+          if (policy == ReplacementPolicy::Fifo)
+            FIFO(e.JT, e.MMT, e.fifoQueue, a.jobId, a.pageNumber, pageSize);
+          else
+            LRU(e.JT, e.MMT, a.jobId, a.pageNumber, pageSize);
+        }
+        return n;
+      });
+    }
+  }
+}
+
+// Whole quiet simulations over a seeded trace, with twice as many pages as
+// frames
+void benchSimulate() {
+  const int pageSize = 4;
+  const int numJobs = 8;
+  for (int frames : {16, 128, 1024}) {
+    auto jobs = benchJobs(numJobs, frames * 2 / numJobs, pageSize);
+    int numAccesses = 20000;
+    auto trace = generateTrace(pagesPerJob(numJobs, pageSize, jobs),
+                               numAccesses, 1);
+    for (auto policy : {ReplacementPolicy::Fifo, ReplacementPolicy::Lru,
+                        ReplacementPolicy::Clock}) {
+      string name = string("simulateDemandPagingTrace/") + policyName(policy);
+      if (!benchSelected(name))
+        continue;
+      // One op is one access; whole runs are repeated to fill the batch
+      runBench(name, to_string(frames) + " frames", "access", [&](long n) {
+        long done = 0;
+        while (done < n) {
+          doNotOptimize(simulateDemandPagingTrace(frames, pageSize, jobs,
+                                                  trace, policy, false));
+          done += numAccesses;
+        }
+        return done;
+      });
+    }
+  }
+}
+
+// Baseline suite: repetitions per case, and the minimum time of one
+// repetition, which runs the case's workload as often as needed
+const int SUITE_REPETITIONS = 7;
+const double SUITE_SAMPLE_SECONDS = 0.05;
+
+// MAD scaled to estimate the standard deviation of normal noise
+const double MAD_TO_SIGMA = 1.4826;
+
+// A throughput drop must also exceed this many combined sigmas to count
+const double REGRESSION_SIGMAS = 3;
+
+// One workload of the baseline suite. run() does the workload once and
+// returns how many ops it did; faultRatio is -1 where it does not apply.
+struct SuiteCase {
+  string name;
+  string param;
+  string unit;
+  function<long()> run;
+  double faultRatio{-1};
+};
+
+// Median and MAD of a case's throughput over the repetitions
+struct SuiteResult {
+  string name;
+  string param;
+  string unit;
+  double medianOpsPerSec{};
+  double madOpsPerSec{};
+  double faultRatio{-1};
+};
+
+double median(vector<double> v) {
+  sort(v.begin(), v.end());
+  size_t n = v.size();
+  return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+// Seeded simulateDemandPagingTrace and translateAddress workloads; their fault
+// ratios are fixed by the seed
+vector<SuiteCase> baselineSuite() {
+  vector<SuiteCase> suite;
+  const int pageSize = 4;
+  const int numJobs = 8;
+  const int numAccesses = 20000;
+  for (int frames : {16, 128}) {
+    auto jobs = benchJobs(numJobs, frames * 2 / numJobs, pageSize);
+    auto trace = make_shared<vector<Access>>(
+        generateTrace(pagesPerJob(numJobs, pageSize, jobs), numAccesses, 1));
+    for (auto policy : {ReplacementPolicy::Fifo, ReplacementPolicy::Lru,
+                        ReplacementPolicy::Clock}) {
+      SuiteCase c;
+      c.name = string("simulateDemandPagingTrace/") + policyName(policy);
+      c.param = to_string(frames) + " frames";
+      c.unit = "access";
+      c.run = [=] {
+        auto s = simulateDemandPagingTrace(frames, pageSize, jobs, *trace,
+                                           policy, false);
+        return (long)s.numAccesses;
+      };
+      c.faultRatio =
+          simulateDemandPagingTrace(frames, pageSize, jobs, *trace, policy,
+                                    false)
+              .failRatio;
+      suite.push_back(c);
+    }
+  }
+  for (int pages : {1024, 65536}) {
+    auto setup = make_shared<TranslateSetup>(makeTranslateSetup(pages, 4096));
+    SuiteCase c;
+    c.name = "translateAddress";
+    c.param = to_string(pages) + " pages";
+    c.unit = "translation";
+    c.run = [=] {
+      const long n = 100000;
+      for (long i = 0; i < n; i++)
+        doNotOptimize(translateAddress(setup->PMT, setup->ram,
+                                       setup->addrs[i & 4095], 4096));
+      return n;
+    };
+    suite.push_back(c);
+  }
+  return suite;
+}
+
+// Runs each case SUITE_REPETITIONS times; each repetition repeats the
+// workload as often as calibration says it takes to fill
+// SUITE_SAMPLE_SECONDS. Repetitions are interleaved across cases so that
+// slow drift of the machine hits every case alike.
+vector<SuiteResult> runSuite() {
+  auto suite = baselineSuite();
+  vector<long> runs(suite.size(), 1);
+  for (size_t c = 0; c < suite.size(); c++) {
+    for (;;) {
+      auto start = chrono::steady_clock::now();
+      for (long i = 0; i < runs[c]; i++)
+        suite[c].run();
+      double seconds =
+          chrono::duration<double>(chrono::steady_clock::now() - start)
+              .count();
+      if (seconds >= SUITE_SAMPLE_SECONDS)
+        break;
+      runs[c] *= 2;
+    }
+  }
+
+  vector<vector<double>> opsPerSec(suite.size());
+  for (int r = 0; r < SUITE_REPETITIONS; r++) {
+    for (size_t c = 0; c < suite.size(); c++) {
+      long ops = 0;
+      auto start = chrono::steady_clock::now();
+      for (long i = 0; i < runs[c]; i++)
+        ops += suite[c].run();
+      double seconds =
+          chrono::duration<double>(chrono::steady_clock::now() - start)
+              .count();
+      opsPerSec[c].push_back(ops / seconds);
+    }
+  }
+
+  vector<SuiteResult> results;
+  for (size_t c = 0; c < suite.size(); c++) {
+    double med = median(opsPerSec[c]);
+    vector<double> deviations;
+    for (double v : opsPerSec[c])
+      deviations.push_back(fabs(v - med));
+    results.push_back({suite[c].name, suite[c].param, suite[c].unit, med,
+                       median(deviations), suite[c].faultRatio});
+  }
+  return results;
+}
+
+const char *BASELINE_HEADER =
+    "name,param,unit,median_ops_per_sec,mad_ops_per_sec,fault_ratio";
+
+void saveBaseline(const string &path, const vector<SuiteResult> &results) {
+  ofstream out(path);
+  if (!out) {
+    throw runtime_error("Cannot open baseline file " + path);
+  }
+  out << BASELINE_HEADER << "\n";
+  char line[512];
+  for (const auto &r : results) {
+    snprintf(line, sizeof(line), "%s,%s,%s,%.3f,%.3f,%.6f\n", r.name.c_str(),
+             r.param.c_str(), r.unit.c_str(), r.medianOpsPerSec,
+             r.madOpsPerSec, r.faultRatio);
+    out << line;
+  }
+  if (!out) {
+    throw runtime_error("Cannot write baseline file " + path);
+  }
+}
+
+vector<SuiteResult> loadBaseline(const string &path) {
+  ifstream in(path);
+  if (!in) {
+    throw runtime_error("Cannot open baseline file " + path);
+  }
+  string line;
+  if (!getline(in, line) || line != BASELINE_HEADER) {
+    throw runtime_error("Not a baseline file: " + path);
+  }
+  vector<SuiteResult> results;
+  while (getline(in, line)) {
+    if (line.empty())
+      continue;
+    vector<string> fields;
+    stringstream ss(line);
+    string field;
+    while (getline(ss, field, ','))
+      fields.push_back(field);
+    if (fields.size() != 6) {
+      throw runtime_error("Malformed baseline line: " + line);
+    }
+    results.push_back({fields[0], fields[1], fields[2], stod(fields[3]),
+                       stod(fields[4]), stod(fields[5])});
+  }
+  return results;
+}
+
+// Compares a fresh suite run with a baseline. Throughput regresses when the
+// median drops by more than threshold and by more than REGRESSION_SIGMAS
+// combined MAD-sigmas; the fault ratio when it rises by more than threshold.
+// Returns whether anything regressed or went missing.
+bool compareBaseline(const vector<SuiteResult> &baseline,
+                     const vector<SuiteResult> &current, double threshold) {
+  printf("name,param,base_ops_per_sec,ops_per_sec,change_pct,"
+         "base_fault_ratio,fault_ratio,status\n");
+  bool regressed = false;
+  for (const auto &cur : current) {
+    const SuiteResult *base = nullptr;
+    for (const auto &b : baseline)
+      if (b.name == cur.name && b.param == cur.param)
+        base = &b;
+    if (!base) {
+      printf("%s,%s,,%.0f,,,", cur.name.c_str(), cur.param.c_str(),
+             cur.medianOpsPerSec);
+      if (cur.faultRatio >= 0)
+        printf("%.4f,new\n", cur.faultRatio);
+      else
+        printf(",new\n");
+      continue;
+    }
+
+    double change = cur.medianOpsPerSec / base->medianOpsPerSec - 1;
+    double noise = REGRESSION_SIGMAS * MAD_TO_SIGMA *
+                   hypot(base->madOpsPerSec, cur.madOpsPerSec);
+    double drop = base->medianOpsPerSec - cur.medianOpsPerSec;
+    const char *status = "ok";
+    if (base->faultRatio >= 0 &&
+        cur.faultRatio > base->faultRatio * (1 + threshold) + 1e-9) {
+      status = "FAULT RATIO REGRESSION";
+    } else if (change < -threshold && drop > noise) {
+      status = "REGRESSION";
+    } else if (change > threshold && -drop > noise) {
+      status = "improved";
+    } else if (fabs(change) > threshold) {
+      status = "noise";
+    }
+    regressed |= status[0] == 'R' || status[0] == 'F';
+
+    printf("%s,%s,%.0f,%.0f,%+.1f,", cur.name.c_str(), cur.param.c_str(),
+           base->medianOpsPerSec, cur.medianOpsPerSec, change * 100);
+    if (cur.faultRatio >= 0)
+      printf("%.4f,%.4f,%s\n", base->faultRatio, cur.faultRatio, status);
+    else
+      printf(",,%s\n", status);
+  }
+
+  // A case that was renamed or dropped could hide a regression, so it fails
+  // the comparison until the baseline is saved again
+  for (const auto &base : baseline) {
+    bool found = false;
+    for (const auto &cur : current)
+      found |= cur.name == base.name && cur.param == base.param;
+    if (found)
+      continue;
+    printf("%s,%s,%.0f,,,", base.name.c_str(), base.param.c_str(),
+           base.medianOpsPerSec);
+    if (base.faultRatio >= 0)
+      printf("%.4f,,missing\n", base.faultRatio);
+    else
+      printf(",,missing\n");
+    regressed = true;
+  }
+  return regressed;
+}
+
+// Scaling sweep: frames grow by SCALING_FACTOR per step from
+// SCALING_MIN_FRAMES to SCALING_MAX_FRAMES, with a job per 16 frames, twice
+// as many pages as frames and 8 accesses per frame
+const int SCALING_MIN_FRAMES = 64;
+const int SCALING_MAX_FRAMES = 262144;
+const int SCALING_FACTOR = 4;
+
+// Time budget of one step; a policy that runs out of it is not scaled
+// further
+const double SCALING_STEP_SECONDS = 2;
+
+struct ScalingPoint {
+  int frames{};
+  int jobs{};
+  int pages{};
+  int accesses{};    // Accesses in the step's trace
+  int accessesRun{}; // Accesses serviced before the budget ran out
+  double nsPerAccess{};
+  double bytesPerPage{};
+};
+
+// Runs one step until the trace ends or the budget runs out
+ScalingPoint runScalingStep(ReplacementPolicy policy, int frames) {
+  const int pageSize = 4;
+  ScalingPoint p;
+  p.frames = frames;
+  p.jobs = frames / 16;
+  p.pages = frames * 2;
+  p.accesses = frames * 8;
+  auto jobs = benchJobs(p.jobs, p.pages / p.jobs, pageSize);
+  auto trace =
+      generateTrace(pagesPerJob(p.jobs, pageSize, jobs), p.accesses, 1);
+
+  int64_t memBefore[NUM_MEM_TAGS], memAfter[NUM_MEM_TAGS];
+  snapshotMemBytes(memBefore);
+  auto start = chrono::steady_clock::now();
+  DemandPagingEngine e;
+  initEngine(e, frames, pageSize, jobs, policy, false);
+  double seconds = 0;
+  for (const auto &a : trace) {
+    engineAccess(e, a.jobId, a.pageNumber);
+    p.accessesRun++;
+    if (p.accessesRun % 256 == 0) {
+      seconds = chrono::duration<double>(chrono::steady_clock::now() - start)
+                    .count();
+      if (seconds > SCALING_STEP_SECONDS)
+        break;
+    }
+  }
+  seconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  snapshotMemBytes(memAfter);
+
+  int64_t bytes = 0;
+  for (int i = 0; i < NUM_MEM_TAGS; i++)
+    bytes += memAfter[i] - memBefore[i];
+  p.nsPerAccess = seconds * 1e9 / p.accessesRun;
+  p.bytesPerPage = (double)bytes / p.pages;
+  return p;
+}
+
+// Prints one CSV row per policy and step with the exponent k of
+// time/access ~ frames^k against the previous step, then a chart of
+// log time per access. k near 0 means O(1) per access, near 1 O(frames).
+void printScalingSweep() {
+  printf("policy,frames,jobs,pages,accesses,accesses_run,ns_per_access,"
+         "bytes_per_page,exponent\n");
+  vector<pair<string, vector<ScalingPoint>>> series;
+  for (auto policy : {ReplacementPolicy::Fifo, ReplacementPolicy::Lru,
+                      ReplacementPolicy::Clock}) {
+    series.push_back({policyName(policy), {}});
+    auto &points = series.back().second;
+    for (int frames = SCALING_MIN_FRAMES; frames <= SCALING_MAX_FRAMES;
+         frames *= SCALING_FACTOR) {
+      auto p = runScalingStep(policy, frames);
+      printf("%s,%d,%d,%d,%d,%d,%.1f,%.1f,", policyName(policy), p.frames,
+             p.jobs, p.pages, p.accesses, p.accessesRun, p.nsPerAccess,
+             p.bytesPerPage);
+      if (points.empty())
+        printf("\n");
+      else
+        printf("%.2f\n", log(p.nsPerAccess / points.back().nsPerAccess) /
+                             log((double)SCALING_FACTOR));
+      fflush(stdout);
+      points.push_back(p);
+      if (p.accessesRun < p.accesses)
+        break; // Out of budget
+    }
+  }
+
+  // One # per factor of 2 in ns/access
+  printf("\n--- Time per Access (log scale) ---\n");
+  for (const auto &kv : series) {
+    for (const auto &p : kv.second) {
+      int bars = max(1, (int)lround(log2(max(p.nsPerAccess, 1.0))));
+      printf("%-6s%8d frames |%s %.0f ns%s\n", kv.first.c_str(), p.frames,
+             string(bars, '#').c_str(), p.nsPerAccess,
+             p.accessesRun < p.accesses ? " (out of budget)" : "");
+    }
+  }
+}
+
+// The benchSimulate workloads fed through a DemandPagingStream in blocks,
+// for comparing its per-access cost with the batch simulator
+void benchStream() {
+  const int pageSize = 4;
+  const int numJobs = 8;
+  for (int frames : {16, 128, 1024}) {
+    auto jobs = benchJobs(numJobs, frames * 2 / numJobs, pageSize);
+    auto trace =
+        generateTrace(pagesPerJob(numJobs, pageSize, jobs), 20000, 1);
+    for (auto policy : {ReplacementPolicy::Fifo, ReplacementPolicy::Lru,
+                        ReplacementPolicy::Clock}) {
+      string name = string("stream/") + policyName(policy);
+      if (!benchSelected(name))
+        continue;
+      DemandPagingStream stream(frames, pageSize, policy);
+      for (const auto &job : jobs)
+        stream.addJob(job);
+      size_t cursor = 0;
+      runBench(name, to_string(frames) + " frames", "access", [&](long n) {
+        for (long done = 0; done < n;) {
+          size_t count = min<size_t>({(size_t)ACCESS_BLOCK_SIZE,
+                                      trace.size() - cursor,
+                                      (size_t)(n - done)});
+          stream.feed(trace.data() + cursor, count);
+          cursor = (cursor + count) % trace.size();
+          done += count;
+        }
+        return n;
+      });
+    }
+  }
+}
+
+// Aging LRU per access at each register width; aging touches every frame,
+// so wider registers cost memory bandwidth as frames grow
+template <class Counter> void benchAgingWidth(int frames) {
+  string name = "agingLru/" + to_string(AgingLru<Counter>::BITS) + "bit";
+  if (!benchSelected(name))
+    return;
+  const int pageSize = 4;
+  const int numJobs = 8;
+  auto jobs = benchJobs(numJobs, frames * 2 / numJobs, pageSize);
+  auto pages = pagesPerJob(numJobs, pageSize, jobs);
+  auto trace = generateTrace(pages, 4096, 1);
+  runBench(name, to_string(frames) + " frames", "access", [&](long n) {
+    int64_t faults = 0;
+    for (long done = 0; done < n; done += trace.size())
+      faults += simulateAgingLru<Counter>(frames, pages, trace).pageFaults;
+    doNotOptimize(faults);
+    return (long)((n + trace.size() - 1) / trace.size() * trace.size());
+  });
+}
+
+void benchAgingWidths() {
+  for (int frames : {64, 1024, 16384}) {
+    benchAgingWidth<uint8_t>(frames);
+    benchAgingWidth<uint16_t>(frames);
+    benchAgingWidth<uint32_t>(frames);
+    benchAgingWidth<uint64_t>(frames);
+  }
+}
+
+// Allocations made so far by the containers of every structure
+int64_t countedAllocations() {
+  int64_t n = 0;
+  for (const auto &c : memCounters)
+    n += c.allocations.load();
+  return n;
+}
+
+// Setup cost of a frame sweep: short runs over a large job mix, rebuilding
+// the tables at every point or resetting one SimulationContext. Both cases
+// include building the point's Stats, as a sweep does. The context case
+// fails if its points allocate.
+void benchSweepSetup() {
+  const int pageSize = 4;
+  const int numJobs = 64;
+  const int maxFrames = 4096;
+  auto jobs = benchJobs(numJobs, 256, pageSize);
+  auto trace = generateTrace(pagesPerJob(numJobs, pageSize, jobs), 256, 1);
+  vector<int> frameCounts;
+  for (int frames = 1; frames <= maxFrames; frames *= 2)
+    frameCounts.push_back(frames);
+  string param = to_string(numJobs * 256) + " pages";
+
+  runBench("sweepPoint/rebuild", param, "point", [&](long n) {
+    int64_t faults = 0;
+    for (long i = 0; i < n; i++)
+      faults += simulateDemandPagingTrace(frameCounts[i % frameCounts.size()],
+                                          pageSize, jobs, trace,
+                                          ReplacementPolicy::Fifo, false)
+                    .pageFaults;
+    doNotOptimize(faults);
+    return n;
+  });
+
+  if (!benchSelected("sweepPoint/context"))
+    return;
+  SimulationContext ctx(maxFrames, pageSize, jobs);
+  int64_t allocationsBefore = countedAllocations();
+  runBench("sweepPoint/context", param, "point", [&](long n) {
+    int64_t faults = 0;
+    for (long i = 0; i < n; i++)
+      faults += simulateSweepPoint(ctx, frameCounts[i % frameCounts.size()],
+                                   ReplacementPolicy::Fifo, trace)
+                    .pageFaults;
+    doNotOptimize(faults);
+    return n;
+  });
+  int64_t allocations = countedAllocations() - allocationsBefore;
+  if (allocations != 0) {
+    throw runtime_error("sweepPoint/context made " + to_string(allocations) +
+                        " allocations; sweep points must not allocate");
+  }
+}
+
+int main(int argc, char **argv) {
+  string saveBaselinePath, comparePath;
+  double threshold = 0.05;
+  bool scaling = false;
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (!strcmp(argv[i], "--perf")) {
+      perfCountersEnabled = true;
+    } else if (!strcmp(argv[i], "--save-baseline") && hasValue) {
+      saveBaselinePath = argv[++i];
+    } else if (!strcmp(argv[i], "--compare") && hasValue) {
+      comparePath = argv[++i];
+    } else if (!strcmp(argv[i], "--scaling")) {
+      scaling = true;
+    } else if (!strcmp(argv[i], "--threshold") && hasValue) {
+      threshold = atof(argv[++i]) / 100;
+    } else if (!strcmp(argv[i], "--help") || argv[i][0] == '-' ||
+               benchFilter) {
+      printf("Usage: %s [--perf] [name filter]\n", argv[0]);
+      printf("       %s --save-baseline FILE\n", argv[0]);
+      printf("       %s --compare FILE [--threshold PERCENT]\n", argv[0]);
+      printf("       %s --scaling\n", argv[0]);
+      return strcmp(argv[i], "--help") ? 1 : 0;
+    } else {
+      benchFilter = argv[i];
+    }
+  }
+
+  try {
+    if (!saveBaselinePath.empty()) {
+      saveBaseline(saveBaselinePath, runSuite());
+      printf("Saved baseline to %s\n", saveBaselinePath.c_str());
+      return 0;
+    }
+    if (scaling) {
+      printScalingSweep();
+      return 0;
+    }
+    if (!comparePath.empty()) {
+      auto baseline = loadBaseline(comparePath);
+      return compareBaseline(baseline, runSuite(), threshold) ? 1 : 0;
+    }
+
+    printf("name,param,iterations,ns_per_op,ops_per_sec,unit");
+    if (perfCountersEnabled)
+      printf(",cycles_per_op,instructions_per_op,llc_misses_per_op,"
+             "dtlb_misses_per_op,branch_misses_per_op");
+    printf("\n");
+    benchDivideIntoPages();
+    benchTranslate();
+    benchHitPath();
+    benchAging();
+    benchEviction();
+    benchSimulate();
+    benchStream();
+    benchSweepSetup();
+    benchAgingWidths();
+  } catch (const exception &e) {
+    printf("Error: %s\n", e.what());
+    return 1;
+  }
+}
@@ -1,459 +1,3028 @@
 // Description: Simulates Demand Paging with page replacement policies (FIFO &
 // LRU)
 //
-// Compile: g++ demand.cpp -std=c++11 -o demand
-
+// Compile: g++ demand.cpp engine.cpp paging.cpp -std=c++20 -pthread
+//          -DPAGING_PHASE_TIMERS -o demand
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <coroutine>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <queue>
 #include <random>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <thread>
 #include <vector>
-#include <bitset>
+
+#ifdef __linux__
+#include <csignal>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "engine.h"
+#include "paging.h"
 
 using namespace std;
 
-// Represent a job with id and size
-struct Job {
-  int id{};
-  int size{};
-};
+// Prints each event per op, or why there is nothing to print
+void printPerfSample(const PerfSample &p, long ops, const char *unit) {
+  if (!perfCountersEnabled)
+    return;
+  if (!p.any()) {
+    printf("Perf Counters: unavailable\n");
+    return;
+  }
+  for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+    if (p.valid[i])
+      printf("%s/%s: %.3f\n", PERF_EVENT_NAMES[i], unit,
+             ops > 0 ? (double)p.values[i] / ops : 0);
+    else
+      printf("%s/%s: n/a\n", PERF_EVENT_NAMES[i], unit);
+  }
+}
 
-// Represent a page frame in main memory
-struct PageFrame {
-  int id{};
-  int startingAddr{};
-  int size{};
-};
+// Jobs and frames shown by printAttribution
+const int ATTRIBUTION_TOP_N = 5;
+
+// Indices of the topN largest counts, largest first
+vector<int> topIndices(const vector<uint64_t> &counts, int topN) {
+  vector<int> idx(counts.size());
+  for (size_t i = 0; i < idx.size(); i++)
+    idx[i] = (int)i;
+  int n = min<int>(topN, (int)idx.size());
+  partial_sort(idx.begin(), idx.begin() + n, idx.end(),
+               [&](int a, int b) { return counts[a] > counts[b]; });
+  idx.resize(n);
+  return idx;
+}
 
-// Represent a page with id and size
-struct Page {
-  int id{};
-  int size{};
-};
+// Prints the jobs with the most faults, the jobs whose pages were evicted
+// most and the frames with the most churn
+void printAttribution(const AttributionCounters &a, int topN) {
+  printf("Top Jobs by Faults:\n");
+  printf("Job\tFaults\tHits\tEvictions Caused\tEvictions Suffered\n");
+  for (int j : topIndices(a.jobFaults, topN))
+    printf("%d\t%llu\t%llu\t%llu\t\t\t%llu\n", j,
+           (unsigned long long)a.jobFaults[j], (unsigned long long)a.jobHits[j],
+           (unsigned long long)a.jobEvictionsCaused[j],
+           (unsigned long long)a.jobEvictionsSuffered[j]);
+  printf("Top Jobs by Evictions Suffered:\n");
+  printf("Job\tEvictions Suffered\n");
+  for (int j : topIndices(a.jobEvictionsSuffered, topN))
+    printf("%d\t%llu\n", j, (unsigned long long)a.jobEvictionsSuffered[j]);
+  printf("Top Frames by Churn:\n");
+  printf("Frame\tLoads\tEvictions\n");
+  for (int f : topIndices(a.frameLoads, topN))
+    printf("%d\t%llu\t%llu\n", f, (unsigned long long)a.frameLoads[f],
+           (unsigned long long)a.frameEvictions[f]);
+}
+
+// Print the memory report of each run (--mem-report)
+bool memReportEnabled = false;
+
+// Where a run's bytes went, in total and per page
+void printMemoryReport(FILE *out, const Stats &s) {
+  fprintf(out, "Memory Report:\n");
+  fprintf(out, "Structure\t\tBytes\t\tBytes/Page\n");
+  int64_t total = 0;
+  for (int i = 0; i < NUM_MEM_TAGS; i++) {
+    total += s.memBytes[i];
+    fprintf(out, "%-16s\t%lld\t\t%.1f\n", MEM_TAG_NAMES[i],
+            (long long)s.memBytes[i],
+            s.totalPages ? (double)s.memBytes[i] / s.totalPages : 0);
+  }
+  fprintf(out, "%-16s\t%lld\t\t%.1f\n", "Total", (long long)total,
+          s.totalPages ? (double)total / s.totalPages : 0);
+}
 
-// Represents the main memory as a vector of page frames
-using MainMemory = vector<PageFrame>;
+// Process-wide peak bytes and allocation counts of every structure
+void printMemoryPeaks(FILE *out) {
+  fprintf(out, "\n--- Peak Memory by Structure ---\n");
+  fprintf(out, "Structure\t\tPeak Bytes\tAllocations\n");
+  for (int i = 0; i < NUM_MEM_TAGS; i++)
+    fprintf(out, "%-16s\t%lld\t\t%lld\n", MEM_TAG_NAMES[i],
+            (long long)memCounters[i].peakBytes.load(),
+            (long long)memCounters[i].allocations.load());
+}
 
-// Page Map Table Row
-struct PageMapTableRow {
-  int pageNumber{};
-  int pageFrameId{};
-  bool inMemory{};
-  uint8_t referenced{};
-};
+// Prints how fast the simulator ran and where its time went
+void printPerformance(const Stats &s) {
+  printf("Wall Time: %.6f s\n", s.wallSeconds);
+  printf("Accesses/sec: %.0f\n", s.accessesPerSec);
+#ifdef PAGING_PHASE_TIMERS
+  printf("Aging: %.6f s\n", s.agingSeconds);
+  printf("Victim Selection: %.6f s\n", s.victimSeconds);
+  printf("Free Frame Search: %.6f s\n", s.freeFrameSeconds);
+  printf("Output: %.6f s\n", s.outputSeconds);
+#endif
+  printf("Peak RSS: %ld KB\n", s.peakRssKb);
+  printPerfSample(s.perf, s.numAccesses, "access");
+}
 
-// Page Map Table
-using PageMapTable = map<int, PageMapTableRow>;
+// Multi-policy fan-out: each block of the trace is generated once and fed to
+// one engine per policy, so every policy sees exactly the same accesses and
+// generation is paid once instead of once per policy. Interleaved mode runs
+// all engines on one thread while the block is hot in cache; threaded mode
+// gives each engine a thread reading shared read-only blocks.
+vector<Stats> simulateFanOut(int numJobs, int numFrames, int pageSize,
+                             int numAccesses, const vector<Job> &jobs,
+                             const vector<ReplacementPolicy> &policies,
+                             unsigned seed, bool threaded) {
+  int numEngines = (int)policies.size();
+  vector<DemandPagingEngine> engines(numEngines);
+  for (int k = 0; k < numEngines; k++)
+    initEngine(engines[k], numFrames, pageSize, jobs, policies[k], false);
+  TraceGenerator tg(pagesPerJob(numJobs, pageSize, jobs), numAccesses, seed);
+
+  if (!threaded) {
+    unique_ptr<AccessBlock> block(new AccessBlock);
+    while (fillBlock(tg, *block) > 0)
+      for (auto &e : engines)
+        for (int i = 0; i < block->count; i++)
+          engineAccess(e, block->accesses[i].jobId,
+                       block->accesses[i].pageNumber);
+  } else {
+    // Ring of shared blocks: a slot is refilled once every engine has
+    // consumed it
+    const int numSlots = 4;
+    vector<AccessBlock> ring(numSlots);
+    vector<long> consumed(numEngines, 0);
+    long produced = 0;
+    bool finished = false;
+    mutex m;
+    condition_variable cv;
+
+    auto runEngine = [&](int k) {
+      for (long next = 0;; next++) {
+        {
+          unique_lock<mutex> lk(m);
+          cv.wait(lk, [&] { return produced > next || finished; });
+          if (produced <= next)
+            return;
+        }
+        const auto &block = ring[next % numSlots];
+        for (int i = 0; i < block.count; i++)
+          engineAccess(engines[k], block.accesses[i].jobId,
+                       block.accesses[i].pageNumber);
+        {
+          lock_guard<mutex> lk(m);
+          consumed[k] = next + 1;
+        }
+        cv.notify_all();
+      }
+    };
+
+    vector<thread> threads;
+    for (int k = 0; k < numEngines; k++)
+      threads.emplace_back(runEngine, k);
+    for (;;) {
+      {
+        unique_lock<mutex> lk(m);
+        cv.wait(lk, [&] {
+          return *min_element(consumed.begin(), consumed.end()) >
+                 produced - numSlots;
+        });
+      }
+      // No engine reads this slot until produced is bumped below
+      if (fillBlock(tg, ring[produced % numSlots]) == 0)
+        break;
+      {
+        lock_guard<mutex> lk(m);
+        produced++;
+      }
+      cv.notify_all();
+    }
+    {
+      lock_guard<mutex> lk(m);
+      finished = true;
+    }
+    cv.notify_all();
+    for (auto &t : threads)
+      t.join();
+  }
 
-// Job Table Row
-struct JobTableRow {
-  int id{};
-  int size{};
-  PageMapTable PMT;
-};
+  vector<Stats> res;
+  for (const auto &e : engines)
+    res.push_back(engineStats(e));
+  return res;
+}
 
-// Job Table
-using JobTable = map<int, JobTableRow>;
+// Compares FIFO, LRU and CLOCK on one shared trace, timing separate runs
+// (one generation per policy) against interleaved and threaded fan-out
+void printFanOutComparison(int numJobs, int numFrames, int pageSize,
+                           int numAccesses, const vector<Job> &jobs) {
+  vector<ReplacementPolicy> policies{ReplacementPolicy::Fifo,
+                                     ReplacementPolicy::Lru,
+                                     ReplacementPolicy::Clock};
+  random_device rnd;
+  unsigned seed = rnd();
+
+  auto start = chrono::steady_clock::now();
+  for (auto policy : policies)
+    simulateFanOut(numJobs, numFrames, pageSize, numAccesses, jobs, {policy},
+                   seed, false);
+  auto mid = chrono::steady_clock::now();
+  auto stats = simulateFanOut(numJobs, numFrames, pageSize, numAccesses, jobs,
+                              policies, seed, false);
+  auto end = chrono::steady_clock::now();
+  auto threadedStats = simulateFanOut(numJobs, numFrames, pageSize,
+                                      numAccesses, jobs, policies, seed, true);
+  auto threadedEnd = chrono::steady_clock::now();
+
+  printf("\n--- Policy Fan-Out (shared trace) ---\n");
+  printf("Policy\tFaults\tHits\tFail Ratio\tSuccess Ratio\n");
+  for (size_t k = 0; k < policies.size(); k++) {
+    if (stats[k].pageFaults != threadedStats[k].pageFaults) {
+      throw runtime_error("Fan-out: threaded and interleaved runs disagree!");
+    }
+    printf("%s\t%lld\t%lld\t%.2f\t\t%.2f\n", policyName(policies[k]),
+           (long long)stats[k].pageFaults, (long long)stats[k].pageHits,
+           stats[k].failRatio, stats[k].successRatio);
+  }
+  printf("Separate runs: %.3f s\n",
+         chrono::duration<double>(mid - start).count());
+  printf("Interleaved fan-out: %.3f s\n",
+         chrono::duration<double>(end - mid).count());
+  printf("Threaded fan-out: %.3f s\n",
+         chrono::duration<double>(threadedEnd - end).count());
+}
 
-// Memory Map Table Row
-struct MemoryMapTableRow {
-  int jobId{};
-  int pageFrameNumber{};
-  int pageNumber{};
-  bool busy{};
+// Faults of true LRU (the aging limit of unbounded width) over a trace
+int simulateExactLru(int numFrames, const vector<int> &pagesPerJob,
+                     const vector<Access> &trace) {
+  auto first = flatPageOffsets(pagesPerJob);
+  vector<int> pageFrame(first.back(), -1);
+  vector<int> framePage(numFrames, -1);
+  vector<int64_t> lastUse(numFrames);
+  int usedFrames = 0, faults = 0;
+  for (size_t t = 0; t < trace.size(); t++) {
+    int page = first[trace[t].jobId] + trace[t].pageNumber;
+    int frame = pageFrame[page];
+    if (frame == -1) {
+      faults++;
+      if (usedFrames < numFrames) {
+        frame = usedFrames++;
+      } else {
+        frame = (int)(min_element(lastUse.begin(), lastUse.end()) -
+                      lastUse.begin());
+        pageFrame[framePage[frame]] = -1;
+      }
+      pageFrame[page] = frame;
+      framePage[frame] = page;
+    }
+    lastUse[frame] = (int64_t)t;
+  }
+  return faults;
+}
+
+// One row of printAgingWidths: the packed registers at Counter's width, then
+// the engine's LRU at the same width, which must fault on the same accesses
+template <class Counter>
+void printAgingRun(int numFrames, int pageSize, const vector<Job> &jobs,
+                   const vector<int> &pages, const vector<Access> &trace,
+                   int exactFaults) {
+  const int bits = 8 * sizeof(Counter);
+  auto r = simulateAgingLru<Counter>(numFrames, pages, trace);
+  auto engine =
+      simulateDemandPagingTrace(numFrames, pageSize, jobs, trace,
+                                ReplacementPolicy::Lru, false, nullptr,
+                                nullptr, bits);
+  if (r.pageFaults != engine.pageFaults) {
+    throw runtime_error("Aging LRU disagrees with the engine's LRU at " +
+                        to_string(bits) + " bits!");
+  }
+  double perAccess = trace.empty() ? 0 : 1e9 / trace.size();
+  printf("%d\t%d\t%+.2f%%\t\t%d\t\t%zu\t\t%.1f\t\t%.1f\n", bits,
+         r.pageFaults,
+         exactFaults > 0 ? 100.0 * (r.pageFaults - exactFaults) / exactFaults
+                         : 0,
+         r.blindEvictions, r.registerBytes, r.seconds * perAccess,
+         engine.wallSeconds * perAccess);
+}
+
+// Aging LRU at 8, 16, 32 and 64 bits on one trace: faults against true LRU,
+// evictions made with no history left, packed register memory, and time per
+// access of the packed registers and of the engine at that width
+void printAgingWidths(int numJobs, int numFrames, int pageSize,
+                      int numAccesses, const vector<Job> &jobs) {
+  random_device rnd;
+  auto pages = pagesPerJob(numJobs, pageSize, jobs);
+  auto trace = generateTrace(pages, numAccesses, rnd());
+
+  int exactFaults = simulateExactLru(numFrames, pages, trace);
+  printf("\nTrue LRU: %d faults\n", exactFaults);
+  printf("\nBits\tFaults\tvs True LRU\tBlind Evictions\tRegister Bytes"
+         "\tns/access\tEngine ns/access\n");
+  printAgingRun<uint8_t>(numFrames, pageSize, jobs, pages, trace, exactFaults);
+  printAgingRun<uint16_t>(numFrames, pageSize, jobs, pages, trace,
+                          exactFaults);
+  printAgingRun<uint32_t>(numFrames, pageSize, jobs, pages, trace,
+                          exactFaults);
+  printAgingRun<uint64_t>(numFrames, pageSize, jobs, pages, trace,
+                          exactFaults);
+}
+
+// Writes a trace as text, one "jobId pageNumber" access per line
+void writeTraceFile(const string &path, const vector<Access> &trace) {
+  FILE *f = fopen(path.c_str(), "w");
+  if (!f) {
+    throw runtime_error("Cannot open trace file for writing: " + path);
+  }
+  for (const auto &a : trace)
+    fprintf(f, "%d %d\n", a.jobId, a.pageNumber);
+  if (fclose(f) != 0) {
+    throw runtime_error("Cannot write trace file: " + path);
+  }
+}
+
+// Incremental parser for text trace files, read in large chunks
+struct TraceDecoder {
+  FILE *f{};
+  vector<char> buf;
+  size_t pos{};
+  size_t len{};
+  bool eof{};
+  vector<int> pagesPerJob; // For validating accesses
+
+  TraceDecoder(const string &path, const vector<int> &pagesPerJob)
+      : buf(1 << 20), pagesPerJob(pagesPerJob) {
+    f = fopen(path.c_str(), "r");
+    if (!f) {
+      throw runtime_error("Cannot open trace file: " + path);
+    }
+  }
+  ~TraceDecoder() { fclose(f); }
 };
 
-// Memory Map Table
-using MemoryMapTable = map<int, MemoryMapTableRow>;
+// Next character of the trace, or -1 at end of file
+int decoderPeek(TraceDecoder &d) {
+  if (d.pos == d.len) {
+    if (d.eof)
+      return -1;
+    d.len = fread(d.buf.data(), 1, d.buf.size(), d.f);
+    d.pos = 0;
+    if (d.len == 0) {
+      d.eof = true;
+      return -1;
+    }
+  }
+  return (unsigned char)d.buf[d.pos];
+}
 
-// Divides a job into pages of given page size
-pair<vector<Page>, PageMapTable> divideIntoPages(const Job &j, int pageSize) {
-  auto size = j.size;
-  vector<Page> res;
-  PageMapTable PMT;
+// Parses the next non-negative integer; false at end of file
+bool decodeInt(TraceDecoder &d, int &value) {
+  int c;
+  while ((c = decoderPeek(d)) == ' ' || c == '\n' || c == '\r' || c == '\t')
+    d.pos++;
+  if (c == -1)
+    return false;
+  if (c < '0' || c > '9') {
+    throw runtime_error("Malformed trace file!");
+  }
+  int64_t wide = 0;
+  while ((c = decoderPeek(d)) >= '0' && c <= '9') {
+    wide = wide * 10 + (c - '0');
+    if (wide > INT_MAX) {
+      throw runtime_error("Malformed trace file: number out of range!");
+    }
+    d.pos++;
+  }
+  value = (int)wide;
+  return true;
+}
+
+// Decodes the next block of accesses; returns how many were decoded
+int decodeBlock(TraceDecoder &d, AccessBlock &block) {
+  block.count = 0;
+  while (block.count < ACCESS_BLOCK_SIZE) {
+    Access a;
+    if (!decodeInt(d, a.jobId))
+      break;
+    if (!decodeInt(d, a.pageNumber)) {
+      throw runtime_error("Malformed trace file: access without a page!");
+    }
+    if (a.jobId < 0 || a.jobId >= (int)d.pagesPerJob.size() ||
+        a.pageNumber < 0 || a.pageNumber >= d.pagesPerJob[a.jobId]) {
+      throw runtime_error("Trace file accesses a page no job has!");
+    }
+    block.accesses[block.count++] = a;
+  }
+  return block.count;
+}
 
-  int i{0};
-  while (size >= pageSize) {
-    Page p;
-    p.id = i;
-    p.size = pageSize;
-    res.push_back(p);
-    size -= pageSize;
-    i++;
+// Single-producer/single-consumer ring of preallocated access blocks. The
+// producer fills the slot at tail and publishes it by bumping tail; the
+// consumer reads the slot at head and hands it back by bumping head. Slots
+// are recycled in place, so nothing is allocated per block.
+class SpscBlockRing {
+public:
+  explicit SpscBlockRing(size_t numSlots) : slots(numSlots) {
+    if (numSlots == 0 || (numSlots & (numSlots - 1)) != 0) {
+      throw runtime_error("Ring size must be a power of two!");
+    }
   }
-  if (size != 0) {
-    Page p;
-    p.id = i;
-    p.size = size;
-    res.push_back(p);
+
+  // Slot to fill next, or nullptr while the ring is full
+  AccessBlock *acquireWrite() {
+    size_t t = tail.load(memory_order_relaxed);
+    if (t - head.load(memory_order_acquire) == slots.size())
+      return nullptr;
+    return &slots[t & (slots.size() - 1)];
+  }
+
+  void publish() {
+    tail.store(tail.load(memory_order_relaxed) + 1, memory_order_release);
+  }
+
+  // Oldest published slot, or nullptr while the ring is empty
+  AccessBlock *acquireRead() {
+    size_t h = head.load(memory_order_relaxed);
+    if (h == tail.load(memory_order_acquire))
+      return nullptr;
+    return &slots[h & (slots.size() - 1)];
+  }
+
+  void release() {
+    head.store(head.load(memory_order_relaxed) + 1, memory_order_release);
   }
 
-  // Build PMT
-  for (const auto &page : res) {
-    PMT[page.id].pageNumber = page.id;
-    PMT[page.id].pageFrameId = -1;
-    PMT[page.id].inMemory = false;
-    PMT[page.id].referenced = 0;
+  // Set by the producer after its last publish
+  void close() { closed.store(true, memory_order_release); }
+  bool isClosed() const { return closed.load(memory_order_acquire); }
+
+private:
+  vector<AccessBlock> slots;
+  alignas(64) atomic<size_t> head{0};
+  alignas(64) atomic<size_t> tail{0};
+  alignas(64) atomic<bool> closed{false};
+};
+
+// Replays a trace file through one engine per policy. Pipelined mode decodes
+// on a separate thread through an SPSC ring so decoding overlaps simulation;
+// otherwise each block is decoded and then simulated on the same thread.
+vector<Stats> simulateTraceFile(const string &path, int numJobs,
+                                int numFrames, int pageSize,
+                                const vector<Job> &jobs,
+                                const vector<ReplacementPolicy> &policies,
+                                bool pipelined) {
+  vector<DemandPagingEngine> engines(policies.size());
+  for (size_t k = 0; k < policies.size(); k++)
+    initEngine(engines[k], numFrames, pageSize, jobs, policies[k], false);
+  TraceDecoder decoder(path, pagesPerJob(numJobs, pageSize, jobs));
+
+  auto simulateBlock = [&](const AccessBlock &block) {
+    for (auto &e : engines)
+      for (int i = 0; i < block.count; i++)
+        engineAccess(e, block.accesses[i].jobId,
+                     block.accesses[i].pageNumber);
+  };
+
+  if (!pipelined) {
+    unique_ptr<AccessBlock> block(new AccessBlock);
+    while (decodeBlock(decoder, *block) > 0)
+      simulateBlock(*block);
+  } else {
+    SpscBlockRing ring(8);
+    exception_ptr decodeError;
+    thread producer([&] {
+      try {
+        for (;;) {
+          AccessBlock *block;
+          while (!(block = ring.acquireWrite()))
+            this_thread::yield();
+          if (decodeBlock(decoder, *block) == 0)
+            break;
+          ring.publish();
+        }
+      } catch (...) {
+        decodeError = current_exception();
+      }
+      ring.close();
+    });
+
+    for (;;) {
+      AccessBlock *block = ring.acquireRead();
+      if (!block) {
+        // Closed is set after the last publish, so recheck before stopping
+        if (ring.isClosed() && !ring.acquireRead())
+          break;
+        this_thread::yield();
+        continue;
+      }
+      simulateBlock(*block);
+      ring.release();
+    }
+    producer.join();
+    if (decodeError)
+      rethrow_exception(decodeError);
   }
 
-  return {res, PMT};
+  vector<Stats> res;
+  for (const auto &e : engines)
+    res.push_back(engineStats(e));
+  return res;
 }
 
-// Prints the Memory Map Table
-void printMMT(const MemoryMapTable &MMT) {
-  printf("MMT:\n");
-  printf("Page Frame Number\tPage Number\tBusy\n");
-  for (const auto kv : MMT) {
-    printf("%d\t\t\t%d\t\t%d\n", kv.second.pageFrameNumber,
-           kv.second.pageNumber, kv.second.busy);
+// Times decoding alone, decode-then-simulate on one thread, and the
+// pipelined replay of a trace file under FIFO, LRU and CLOCK
+void printTraceReplay(const string &path, int numJobs, int numFrames,
+                      int pageSize, const vector<Job> &jobs) {
+  vector<ReplacementPolicy> policies{ReplacementPolicy::Fifo,
+                                     ReplacementPolicy::Lru,
+                                     ReplacementPolicy::Clock};
+
+  auto start = chrono::steady_clock::now();
+  long decoded = 0;
+  {
+    TraceDecoder decoder(path, pagesPerJob(numJobs, pageSize, jobs));
+    unique_ptr<AccessBlock> block(new AccessBlock);
+    while (decodeBlock(decoder, *block) > 0)
+      decoded += block->count;
   }
-  printf("\n");
+  auto decodeEnd = chrono::steady_clock::now();
+  auto stats = simulateTraceFile(path, numJobs, numFrames, pageSize, jobs,
+                                 policies, false);
+  auto inlineEnd = chrono::steady_clock::now();
+  auto pipelinedStats = simulateTraceFile(path, numJobs, numFrames, pageSize,
+                                          jobs, policies, true);
+  auto pipelinedEnd = chrono::steady_clock::now();
+
+  printf("\n--- Trace Replay (%ld accesses) ---\n", decoded);
+  printf("Policy\tFaults\tHits\tFail Ratio\tSuccess Ratio\n");
+  for (size_t k = 0; k < policies.size(); k++) {
+    if (stats[k].pageFaults != pipelinedStats[k].pageFaults) {
+      throw runtime_error("Replay: pipelined and inline runs disagree!");
+    }
+    printf("%s\t%lld\t%lld\t%.2f\t\t%.2f\n", policyName(policies[k]),
+           (long long)stats[k].pageFaults, (long long)stats[k].pageHits,
+           stats[k].failRatio, stats[k].successRatio);
+  }
+  printf("Decode only: %.3f s\n",
+         chrono::duration<double>(decodeEnd - start).count());
+  printf("Decode then simulate: %.3f s\n",
+         chrono::duration<double>(inlineEnd - decodeEnd).count());
+  printf("Pipelined: %.3f s\n",
+         chrono::duration<double>(pipelinedEnd - inlineEnd).count());
 }
 
-// Prints the Page Map Table
-void printPMT(const PageMapTable &PMT) {
-  printf("PMT:\n");
-  printf("Page Number\tPage Frame ID\tReference Bit\n");
-  for (const auto &kv : PMT) {
-    printf("%d\t\t%d\t\t0b%s\n", kv.second.pageNumber, kv.second.pageFrameId,
-           bitset<sizeof(int)*2>(kv.second.referenced).to_string().c_str());
+// Free-list pool for coroutine frames. Every job coroutine frame has the same
+// size, so finished frames are handed to the next job instead of going back
+// to the heap.
+struct FramePool {
+  vector<void *> freeFrames;
+  size_t frameSize{};
+  uint64_t allocations{};
+  uint64_t reuses{};
+
+  ~FramePool() {
+    for (void *p : freeFrames)
+      ::operator delete(p);
   }
-  printf("\n");
+};
+
+thread_local FramePool framePool;
+
+void *allocCoroutineFrame(size_t size) {
+  if (framePool.frameSize == 0)
+    framePool.frameSize = size;
+  if (size == framePool.frameSize && !framePool.freeFrames.empty()) {
+    void *p = framePool.freeFrames.back();
+    framePool.freeFrames.pop_back();
+    framePool.reuses++;
+    return p;
+  }
+  framePool.allocations++;
+  return ::operator new(size);
 }
 
-// FIFO Replacement Algorithm
-int FIFO(JobTable &JT, MemoryMapTable &MMT, queue<int> &fifoQueue, int jobId,
-         int pageNum, int pageSize) {
+void freeCoroutineFrame(void *p, size_t size) {
+  if (size == framePool.frameSize)
+    framePool.freeFrames.push_back(p);
+  else
+    ::operator delete(p);
+}
 
-  // Scenario where we have free frame: no need for replacing
-  for (auto &kv : MMT) {
-    if (!kv.second.busy) {
-      int frameNum = kv.second.pageFrameNumber;
+// Coroutine running one job. It starts suspended and stays suspended at the
+// end, so the scheduler decides when it runs and when its frame goes away.
+struct JobTask {
+  struct promise_type {
+    JobTask get_return_object() {
+      return JobTask{coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    suspend_always initial_suspend() noexcept { return {}; }
+    suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { throw; }
+
+    static void *operator new(size_t size) {
+      return allocCoroutineFrame(size);
+    }
+    static void operator delete(void *p, size_t size) {
+      freeCoroutineFrame(p, size);
+    }
+  };
 
-      JT[jobId].PMT[pageNum].pageFrameId = frameNum;
-      JT[jobId].PMT[pageNum].inMemory = true;
+  coroutine_handle<promise_type> handle;
+};
 
-      kv.second.pageNumber = pageNum;
-      kv.second.busy = true;
-      kv.second.jobId = jobId;
+// Single-CPU scheduler for job coroutines. One access takes one tick of CPU
+// time; a fault blocks the job for faultLatency ticks of simulated I/O while
+// other ready jobs run. A job that keeps hitting is preempted after quantum
+// accesses.
+struct CoroutineScheduler {
+  CoroutineScheduler(DemandPagingEngine &engine, int faultLatency, int quantum)
+      : engine(engine), faultLatency(faultLatency), quantum(quantum) {}
+
+  DemandPagingEngine &engine;
+  int faultLatency{};
+  int quantum{};
+  deque<coroutine_handle<>> runQueue;
+  // Jobs blocked on a fault, soonest I/O completion first
+  priority_queue<pair<long, coroutine_handle<>>,
+                 vector<pair<long, coroutine_handle<>>>,
+                 greater<pair<long, coroutine_handle<>>>>
+      ioWait;
+  long now{};
+  long busyTicks{};
+  long idleTicks{};
+  long switches{};
+  int quantumLeft{};
+};
 
-      fifoQueue.push(frameNum);
+// Awaited by a job for each access. Hits within the quantum never suspend;
+// a fault suspends the job until its I/O completes, and an expired quantum
+// sends it to the back of the run queue.
+struct AccessAwaiter {
+  CoroutineScheduler &s;
+  int jobId;
+  int pageNum;
+  bool faulted{};
+
+  bool await_ready() {
+    int64_t faultsBefore = s.engine.pageFaults;
+    engineAccess(s.engine, jobId, pageNum);
+    s.now++;
+    s.busyTicks++;
+    faulted = s.engine.pageFaults != faultsBefore;
+    return !faulted && --s.quantumLeft > 0;
+  }
 
-      printf(" Loaded into free Frame %d\n", frameNum);
-      return frameNum;
+  void await_suspend(coroutine_handle<> h) {
+    if (faulted)
+      s.ioWait.push({s.now + s.faultLatency, h});
+    else
+      s.runQueue.push_back(h);
+  }
+
+  void await_resume() {}
+};
+
+// A job: numAccesses random accesses to its own pages
+JobTask runJobCoroutine(CoroutineScheduler &s, int jobId, int numPages,
+                        int numAccesses, unsigned seed) {
+  mt19937 gen(seed);
+  uniform_int_distribution<> pageDist(0, numPages - 1);
+  for (int i = 0; i < numAccesses; i++)
+    co_await AccessAwaiter{s, jobId, pageDist(gen)};
+}
+
+// Runs the scheduler until every job has finished. When nothing is ready the
+// CPU idles until the earliest outstanding I/O completes.
+void runScheduler(CoroutineScheduler &s) {
+  while (!s.runQueue.empty() || !s.ioWait.empty()) {
+    if (s.runQueue.empty()) {
+      s.idleTicks += max(0L, s.ioWait.top().first - s.now);
+      s.now = max(s.now, s.ioWait.top().first);
+    }
+    while (!s.ioWait.empty() && s.ioWait.top().first <= s.now) {
+      s.runQueue.push_back(s.ioWait.top().second);
+      s.ioWait.pop();
     }
+
+    auto h = s.runQueue.front();
+    s.runQueue.pop_front();
+    s.quantumLeft = s.quantum;
+    s.switches++;
+    h.resume();
+    if (h.done())
+      h.destroy();
   }
+}
+
+struct CoroutineStats {
+  Stats paging;
+  long ticks{};
+  long busyTicks{};
+  long idleTicks{};
+  long switches{};
+  double cpuUtilization{};
+  double seconds{};
+};
 
-  // If we don't have a free frame replace
-  if (fifoQueue.empty()) {
+// Coroutine-based Demand Paging Simulation: every job is a coroutine that
+// blocks on its own faults while the others keep the CPU busy
+CoroutineStats simulateCoroutineDemandPaging(int numJobs, int numFrames,
+                                             int pageSize, int numAccesses,
+                                             const vector<Job> &jobs,
+                                             ReplacementPolicy policy,
+                                             int faultLatency, int quantum,
+                                             unsigned seed) {
+  if (faultLatency < 0 || quantum <= 0) {
     throw runtime_error(
-        "FIFO queue is empty — memory not initialized correctly!");
+        "Fault latency must be non-negative and quantum positive!");
+  }
+  DemandPagingEngine e;
+  initEngine(e, numFrames, pageSize, jobs, policy, false);
+  CoroutineScheduler s(e, faultLatency, quantum);
+
+  auto pages = pagesPerJob(numJobs, pageSize, jobs);
+  mt19937 seeds(seed);
+  for (int j = 0; j < numJobs; j++) {
+    int share = numAccesses / numJobs + (j < numAccesses % numJobs);
+    if (share > 0 && pages[j] > 0)
+      s.runQueue.push_back(
+          runJobCoroutine(s, j, pages[j], share, seeds()).handle);
+  }
+
+  auto start = chrono::steady_clock::now();
+  runScheduler(s);
+  double seconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  CoroutineStats cs;
+  cs.paging = engineStats(e);
+  cs.ticks = s.now;
+  cs.busyTicks = s.busyTicks;
+  cs.idleTicks = s.idleTicks;
+  cs.switches = s.switches;
+  cs.cpuUtilization = s.now ? (double)s.busyTicks / s.now : 0;
+  cs.seconds = seconds;
+  return cs;
+}
+
+// Runs the coroutine job model under FIFO, LRU and CLOCK with one seed
+void printCoroutineComparison(int numJobs, int numFrames, int pageSize,
+                              int numAccesses, const vector<Job> &jobs,
+                              int faultLatency, int quantum) {
+  random_device rnd;
+  unsigned seed = rnd();
+
+  printf("\n--- Coroutine Jobs (fault latency %d ticks, quantum %d) ---\n",
+         faultLatency, quantum);
+  printf("Policy\tFaults\tFail Ratio\tTicks\tCPU Utilization\tFault Idle "
+         "Ticks\tSwitches\tSwitches/s\n");
+  for (auto policy : {ReplacementPolicy::Fifo, ReplacementPolicy::Lru,
+                      ReplacementPolicy::Clock}) {
+    auto cs = simulateCoroutineDemandPaging(numJobs, numFrames, pageSize,
+                                            numAccesses, jobs, policy,
+                                            faultLatency, quantum, seed);
+    printf("%s\t%lld\t%.2f\t\t%ld\t%.1f%%\t\t%ld\t\t\t%ld\t\t%.0f\n",
+           policyName(policy), (long long)cs.paging.pageFaults,
+           cs.paging.failRatio,
+           cs.ticks, 100 * cs.cpuUtilization, cs.idleTicks, cs.switches,
+           cs.seconds > 0 ? cs.switches / cs.seconds : 0);
   }
+  printf("Coroutine frames: %llu allocated, %llu reused from the pool\n",
+         (unsigned long long)framePool.allocations,
+         (unsigned long long)framePool.reuses);
+}
+
+// Per-CPU lock accounting for the concurrent simulation
+struct LockStats {
+  uint64_t acquisitions{};
+  uint64_t contended{};
+  uint64_t waitNs{};
+};
+
+// Acquires a lock, recording whether the acquisition had to wait
+void lockCounted(mutex &m, LockStats &ls) {
+  ls.acquisitions++;
+  if (m.try_lock())
+    return;
+
+  ls.contended++;
+  auto start = chrono::steady_clock::now();
+  m.lock();
+  ls.waitNs += chrono::duration_cast<chrono::nanoseconds>(
+                   chrono::steady_clock::now() - start)
+                   .count();
+}
+
+// CLOCK frame states, claimed with compare-and-swap
+const uint32_t FRAME_FREE = 0;
+const uint32_t FRAME_RESIDENT = 1;
+const uint32_t FRAME_CLAIMED = 2;
 
-  int replacedFrame = fifoQueue.front();
-  fifoQueue.pop();
+// Owner tag of a frame holding no page
+const uint64_t NO_OWNER = ~0ULL;
 
-  int oldJobId = MMT[replacedFrame].jobId;
-  int oldPageNum = MMT[replacedFrame].pageNumber;
+// Packs a job and page into a frame owner tag
+uint64_t ownerTag(int jobId, int pageNum) {
+  return ((uint64_t)(uint32_t)jobId << 32) | (uint32_t)pageNum;
+}
 
-  // mark oldest out of memory
-  JT[oldJobId].PMT[oldPageNum].inMemory = false;
-  JT[oldJobId].PMT[oldPageNum].pageFrameId = -1;
+// Frame table row shared by all CPUs. FIFO and LRU guard it with its own
+// lock; the aging register lives with the frame since only resident pages are
+// ever aged. CLOCK never takes the lock: hits set the reference bit and the
+// hand claims victims through the atomic state and owner tag.
+struct SharedFrame {
+  mutex lock;
+  int jobId{-1};
+  int pageNumber{-1};
+  bool busy{};
+  AgingRegister referenced{};
 
-  printf("\tReplacing P%d J%d (F%d) with P%d of J%d (FIFO)\n", oldPageNum,
-         oldJobId, replacedFrame, pageNum, jobId);
+  atomic<uint8_t> refBit{0};
+  atomic<uint32_t> state{FRAME_FREE};
+  atomic<uint64_t> owner{NO_OWNER};
+};
 
-  // Load new page into replaced frame
-  JT[jobId].PMT[pageNum].pageFrameId = replacedFrame;
-  JT[jobId].PMT[pageNum].inMemory = true;
+// Page table row shared by all CPUs, written under its PMT bucket lock. The
+// frame id is atomic so the CLOCK hit path can read it without the lock.
+struct SharedPageRow {
+  atomic<int> pageFrameId{-1};
+};
 
-  MMT[replacedFrame].pageNumber = pageNum;
-  MMT[replacedFrame].jobId = jobId;
-  MMT[replacedFrame].busy = true;
+// Frame table, page tables and replacement state shared by all CPUs.
+// Lock order is PMT bucket -> frame; a frame holder only ever try_locks a
+// bucket, and the free list and FIFO queue locks are never held with another.
+struct SharedMemory {
+  vector<SharedFrame> frames;
+  vector<vector<SharedPageRow>> pages; // Indexed by job id then page number
+  vector<mutex> pmtBuckets;
+  mutex freeLock;
+  vector<int> freeFrames;
+  mutex fifoLock;
+  queue<int> fifoQueue;
+  atomic<uint32_t> clockHand{0};
+  atomic<uint64_t> ticks{0};
+  ReplacementPolicy policy{ReplacementPolicy::Fifo};
 
-  fifoQueue.push(replacedFrame);
+  SharedMemory(int numFrames, int numBuckets)
+      : frames(numFrames), pmtBuckets(numBuckets) {}
+};
+
+// Per-CPU results of the concurrent simulation
+struct CpuStats {
+  int accesses{};
+  int pageHits{};
+  int pageFaults{};
+  int evictions{};
+  int victimRetries{};
+  uint64_t casRetries{};
+  LockStats locks;
+};
+
+struct ConcurrentStats {
+  int threads{};
+  int pageFrames{};
+  int numAccesses{};
+  int pageFaults{};
+  int pageHits{};
+  double failRatio{};
+  double seconds{};
+  double accessesPerSec{};
+  double faultsPerSec{};
+  uint64_t lockAcquisitions{};
+  uint64_t contendedAcquisitions{};
+  double lockWaitSeconds{};
+  int victimRetries{};
+  uint64_t casRetries{};
+};
 
-  return replacedFrame;
+// Maps a page onto the PMT bucket lock guarding it
+size_t pmtBucket(const SharedMemory &mem, int jobId, int pageNum) {
+  return ((size_t)jobId * 0x9E3779B1u + (size_t)pageNum) %
+         mem.pmtBuckets.size();
 }
 
-// LRU Replacement Algorithm
-int LRU(JobTable &JT, MemoryMapTable &MMT, int jobId, int pageNum,
-        int pageSize) {
-  for (auto &kv : MMT) {
-    if (!kv.second.busy) {
-      int frameNum = kv.second.pageFrameNumber;
+// Pops a free frame, or -1 if all frames are busy
+int allocSharedFreeFrame(SharedMemory &mem, LockStats &ls) {
+  lockCounted(mem.freeLock, ls);
+  int frameNum = -1;
+  if (!mem.freeFrames.empty()) {
+    frameNum = mem.freeFrames.back();
+    mem.freeFrames.pop_back();
+  }
+  mem.freeLock.unlock();
+  return frameNum;
+}
 
-      JT[jobId].PMT[pageNum].pageFrameId = frameNum;
-      JT[jobId].PMT[pageNum].inMemory = true;
-      JT[jobId].PMT[pageNum].referenced = 0x80; // Set MSB on reference
+// Picks the frame to replace: the FIFO head, or the frame with the smallest
+// aging register for LRU. Returns -1 if the FIFO queue is momentarily empty.
+int pickSharedVictim(SharedMemory &mem, LockStats &ls) {
+  if (mem.policy == ReplacementPolicy::Fifo) {
+    lockCounted(mem.fifoLock, ls);
+    if (mem.fifoQueue.empty()) {
+      // Every frame is between a victim claim and its reload; the caller
+      // retries once one is queued again
+      mem.fifoLock.unlock();
+      return -1;
+    }
+    int frameNum = mem.fifoQueue.front();
+    mem.fifoQueue.pop();
+    mem.fifoLock.unlock();
+    return frameNum;
+  }
 
-      kv.second.pageNumber = pageNum;
-      kv.second.jobId = jobId;
-      kv.second.busy = true;
+  int lruFrame = -1;
+  uint64_t smallestRef = UINT64_MAX;
+  for (size_t i = 0; i < mem.frames.size(); i++) {
+    auto &frame = mem.frames[i];
+    lockCounted(frame.lock, ls);
+    if (frame.busy && frame.referenced < smallestRef) {
+      smallestRef = frame.referenced;
+      lruFrame = (int)i;
+    }
+    frame.lock.unlock();
+  }
+  if (lruFrame == -1) {
+    throw runtime_error("LRU: No frame found for replacement!");
+  }
+  return lruFrame;
+}
 
-      printf(" Loaded into free Frame %d\n", frameNum);
+// Evicts a FIFO or LRU victim on behalf of a faulting page whose bucket lock
+// is held. Returns the frame with its lock held, or -1 after too many
+// attempts so the caller can drop its bucket and retry instead of livelocking.
+int claimSharedVictim(SharedMemory &mem, size_t heldBucket, CpuStats &cs) {
+  int maxAttempts = 2 * (int)mem.frames.size() + 8;
+  for (int attempt = 0; attempt < maxAttempts; attempt++) {
+    int frameNum = pickSharedVictim(mem, cs.locks);
+    if (frameNum == -1)
+      return -1;
+    auto &frame = mem.frames[frameNum];
+    lockCounted(frame.lock, cs.locks);
+
+    size_t ownerBucket = pmtBucket(mem, frame.jobId, frame.pageNumber);
+    bool ownBucket = ownerBucket == heldBucket;
+    if (!ownBucket)
+      cs.locks.acquisitions++;
+    if (frame.busy && (ownBucket || mem.pmtBuckets[ownerBucket].try_lock())) {
+      auto &old = mem.pages[frame.jobId][frame.pageNumber];
+      old.pageFrameId.store(-1, memory_order_relaxed);
+      if (!ownBucket)
+        mem.pmtBuckets[ownerBucket].unlock();
+      cs.evictions++;
       return frameNum;
     }
+
+    // Owner page is being worked on by another CPU: put the frame back
+    frame.lock.unlock();
+    cs.victimRetries++;
+    cs.locks.contended++;
+    if (mem.policy == ReplacementPolicy::Fifo) {
+      lockCounted(mem.fifoLock, cs.locks);
+      mem.fifoQueue.push(frameNum);
+      mem.fifoLock.unlock();
+    }
   }
+  return -1;
+}
 
-  // Find the least recently used frame
-  int lruFrame = -1;
-  uint8_t smallestRef = 0xFF;
-
-  for (const auto &kv : MMT) {
-    if (kv.second.busy) {
-      int residentJobId = kv.second.jobId;
-      int residentPageNumber = kv.second.pageNumber;
-      auto ref = JT[residentJobId].PMT[residentPageNumber].referenced;
-      if (ref < smallestRef) {
-        smallestRef = JT[residentJobId].PMT[residentPageNumber].referenced;
-        lruFrame = kv.second.pageFrameNumber;
+// Sweeps the CLOCK hand until it claims a resident frame whose reference bit
+// is clear. The hand only advances by CAS, and a victim is only taken by
+// moving its state from resident to claimed, so two CPUs never evict the same
+// frame. Returns the claimed frame with its old page unmapped, or -1 as for
+// claimSharedVictim.
+int claimClockVictim(SharedMemory &mem, size_t heldBucket, CpuStats &cs) {
+  uint32_t numFrames = (uint32_t)mem.frames.size();
+  int maxSteps = 4 * (int)numFrames + 8;
+  for (int step = 0; step < maxSteps; step++) {
+    uint32_t hand = mem.clockHand.load(memory_order_relaxed);
+    if (!mem.clockHand.compare_exchange_weak(hand, (hand + 1) % numFrames,
+                                             memory_order_relaxed)) {
+      cs.casRetries++;
+      continue;
+    }
+
+    auto &frame = mem.frames[hand];
+    if (frame.refBit.load(memory_order_relaxed)) {
+      frame.refBit.store(0, memory_order_relaxed); // Second chance
+      continue;
+    }
+    uint32_t expected = FRAME_RESIDENT;
+    if (!frame.state.compare_exchange_strong(expected, FRAME_CLAIMED,
+                                             memory_order_acquire)) {
+      cs.casRetries++;
+      continue;
+    }
+
+    uint64_t tag = frame.owner.load(memory_order_relaxed);
+    int oldJobId = (int)(tag >> 32);
+    int oldPageNum = (int)(uint32_t)tag;
+    size_t ownerBucket = pmtBucket(mem, oldJobId, oldPageNum);
+    bool ownBucket = ownerBucket == heldBucket;
+    if (!ownBucket)
+      cs.locks.acquisitions++;
+    if (!ownBucket && !mem.pmtBuckets[ownerBucket].try_lock()) {
+      // Owner page is being worked on by another CPU: release the claim
+      frame.state.store(FRAME_RESIDENT, memory_order_release);
+      cs.victimRetries++;
+      cs.locks.contended++;
+      continue;
+    }
+
+    frame.owner.store(NO_OWNER, memory_order_release);
+    mem.pages[oldJobId][oldPageNum].pageFrameId.store(-1,
+                                                      memory_order_relaxed);
+    if (!ownBucket)
+      mem.pmtBuckets[ownerBucket].unlock();
+    cs.evictions++;
+    return (int)hand;
+  }
+  return -1;
+}
+
+// Shifts every resident page's aging register right one bit (for LRU)
+void ageSharedFrames(SharedMemory &mem, LockStats &ls) {
+  for (auto &frame : mem.frames) {
+    lockCounted(frame.lock, ls);
+    if (frame.busy)
+      frame.referenced = agedRegister(frame.referenced, DEFAULT_AGING_BITS);
+    frame.lock.unlock();
+  }
+}
+
+// Lock-free CLOCK hit: the frame still has to be owned by this page, otherwise
+// the access falls through to the locked path
+bool clockHit(SharedMemory &mem, int jobId, int pageNum,
+              const SharedPageRow &page) {
+  int frameNum = page.pageFrameId.load(memory_order_acquire);
+  if (frameNum < 0)
+    return false;
+  auto &frame = mem.frames[frameNum];
+  if (frame.owner.load(memory_order_acquire) != ownerTag(jobId, pageNum))
+    return false;
+  frame.refBit.store(1, memory_order_relaxed);
+  return true;
+}
+
+// Services one access from a CPU against the shared tables
+void sharedAccess(SharedMemory &mem, int jobId, int pageNum,
+                  int agingInterval, CpuStats &cs) {
+  cs.accesses++;
+  bool clock = mem.policy == ReplacementPolicy::Clock;
+  auto &page = mem.pages[jobId][pageNum];
+  if (clock && clockHit(mem, jobId, pageNum, page)) {
+    cs.pageHits++;
+    return;
+  }
+  if (mem.policy == ReplacementPolicy::Lru &&
+      mem.ticks.fetch_add(1, memory_order_relaxed) % agingInterval == 0)
+    ageSharedFrames(mem, cs.locks);
+
+  size_t bucket = pmtBucket(mem, jobId, pageNum);
+  for (;;) {
+    lockCounted(mem.pmtBuckets[bucket], cs.locks);
+
+    int resident = page.pageFrameId.load(memory_order_relaxed);
+    if (resident >= 0) {
+      cs.pageHits++;
+      auto &frame = mem.frames[resident];
+      if (clock) {
+        frame.refBit.store(1, memory_order_relaxed);
+      } else {
+        lockCounted(frame.lock, cs.locks);
+        frame.referenced |= AGING_MSB; // Set MSB on reference
+        frame.lock.unlock();
       }
+      mem.pmtBuckets[bucket].unlock();
+      return;
     }
+
+    int frameNum = allocSharedFreeFrame(mem, cs.locks);
+    if (frameNum == -1) {
+      frameNum = clock ? claimClockVictim(mem, bucket, cs)
+                       : claimSharedVictim(mem, bucket, cs);
+      if (frameNum == -1) {
+        mem.pmtBuckets[bucket].unlock();
+        this_thread::yield();
+        continue;
+      }
+    } else if (!clock) {
+      lockCounted(mem.frames[frameNum].lock, cs.locks);
+    }
+
+    // Load page into the claimed frame (its lock is held unless CLOCK)
+    auto &frame = mem.frames[frameNum];
+    if (clock) {
+      frame.refBit.store(1, memory_order_relaxed);
+      frame.owner.store(ownerTag(jobId, pageNum), memory_order_release);
+      frame.state.store(FRAME_RESIDENT, memory_order_release);
+    } else {
+      frame.jobId = jobId;
+      frame.pageNumber = pageNum;
+      frame.busy = true;
+      frame.referenced = AGING_MSB; // Set MSB on reference
+      frame.lock.unlock();
+    }
+
+    page.pageFrameId.store(frameNum, memory_order_release);
+    mem.pmtBuckets[bucket].unlock();
+    cs.pageFaults++;
+
+    if (mem.policy == ReplacementPolicy::Fifo) {
+      lockCounted(mem.fifoLock, cs.locks);
+      mem.fifoQueue.push(frameNum);
+      mem.fifoLock.unlock();
+    }
+    return;
   }
+}
 
-  if (lruFrame == -1) {
-    throw runtime_error("LRU: No frame found for replacement!");
+// Runs one CPU: random accesses to random pages of the jobs it was given
+void runSharedCpu(SharedMemory &mem, const vector<int> &cpuJobs,
+                  int numAccesses, int agingInterval, unsigned seed,
+                  CpuStats &cs) {
+  mt19937 gen(seed);
+  uniform_int_distribution<> jobDist(0, (int)cpuJobs.size() - 1);
+
+  for (int access = 0; access < numAccesses; access++) {
+    int jobId = cpuJobs[jobDist(gen)];
+    const auto &pages = mem.pages[jobId];
+    if (pages.empty())
+      continue;
+    uniform_int_distribution<> pageDist(0, (int)pages.size() - 1);
+    sharedAccess(mem, jobId, pageDist(gen), agingInterval, cs);
   }
+}
 
-  int oldJobId = MMT[lruFrame].jobId;
-  int oldPageNum = MMT[lruFrame].pageNumber;
+// Builds the shared tables for the jobs, with every frame free
+void initSharedMemory(SharedMemory &mem, int numJobs, int pageSize,
+                      const vector<Job> &jobs, ReplacementPolicy policy) {
+  mem.policy = policy;
+  mem.pages.resize(numJobs);
+  for (const auto &job : jobs) {
+    auto divRes = divideIntoPages(job, pageSize);
+    mem.pages[job.id] = vector<SharedPageRow>(divRes.first.size());
+  }
+  for (int i = (int)mem.frames.size() - 1; i >= 0; i--)
+    mem.freeFrames.push_back(i);
+}
 
-  // Mark old page out of memory
-  JT[oldJobId].PMT[oldPageNum].inMemory = false;
-  JT[oldJobId].PMT[oldPageNum].pageFrameId = -1;
-  JT[oldJobId].PMT[oldPageNum].referenced = 0; // Clear reference
+// Gives each CPU a subset of the jobs; CPUs beyond the job count share
+vector<vector<int>> assignJobsToCpus(int numJobs, int numThreads) {
+  vector<vector<int>> cpuJobs(numThreads);
+  if (numThreads <= numJobs) {
+    for (int j = 0; j < numJobs; j++)
+      cpuJobs[j % numThreads].push_back(j);
+  } else {
+    for (int t = 0; t < numThreads; t++)
+      cpuJobs[t].push_back(t % numJobs);
+  }
+  return cpuJobs;
+}
 
-  printf("\tReplacing P%d of J%d (F%d) with P%d of J%d (LRU)\n", oldPageNum,
-         oldJobId, lruFrame, pageNum, jobId);
+// Runs numThreads CPUs over the shared tables and folds their results
+ConcurrentStats runSharedCpus(SharedMemory &mem, int numJobs, int numAccesses,
+                              int numThreads, int agingInterval) {
+  auto cpuJobs = assignJobsToCpus(numJobs, numThreads);
+  vector<CpuStats> cpuStats(numThreads);
+  vector<thread> cpus;
+  random_device rnd;
+  vector<unsigned> seeds(numThreads);
+  for (auto &seed : seeds)
+    seed = rnd();
+
+  auto start = chrono::steady_clock::now();
+  for (int t = 0; t < numThreads; t++) {
+    int share = numAccesses / numThreads + (t < numAccesses % numThreads);
+    cpus.emplace_back(runSharedCpu, ref(mem), cref(cpuJobs[t]), share,
+                      agingInterval, seeds[t], ref(cpuStats[t]));
+  }
+  for (auto &cpu : cpus)
+    cpu.join();
+  double seconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  ConcurrentStats s;
+  s.threads = numThreads;
+  s.pageFrames = (int)mem.frames.size();
+  s.numAccesses = numAccesses;
+  s.seconds = seconds;
+  for (const auto &cs : cpuStats) {
+    s.pageFaults += cs.pageFaults;
+    s.pageHits += cs.pageHits;
+    s.victimRetries += cs.victimRetries;
+    s.casRetries += cs.casRetries;
+    s.lockAcquisitions += cs.locks.acquisitions;
+    s.contendedAcquisitions += cs.locks.contended;
+    s.lockWaitSeconds += cs.locks.waitNs / 1e9;
+  }
+  s.failRatio = (double)s.pageFaults / numAccesses;
+  s.accessesPerSec = seconds > 0 ? numAccesses / seconds : 0;
+  s.faultsPerSec = seconds > 0 ? s.pageFaults / seconds : 0;
+  return s;
+}
 
-  // Load new page into replaced frame
-  JT[jobId].PMT[pageNum].pageFrameId = lruFrame;
-  JT[jobId].PMT[pageNum].inMemory = true;
-  JT[jobId].PMT[pageNum].referenced = 0x80; // Set MSB on reference
+// Concurrent Demand Paging Simulation: numThreads CPUs, each running a subset
+// of the jobs, share one frame table and the jobs' page tables
+ConcurrentStats simulateConcurrentDemandPaging(int numJobs, int numFrames,
+                                               int pageSize, int numAccesses,
+                                               const vector<Job> &jobs,
+                                               ReplacementPolicy policy,
+                                               int numThreads,
+                                               int agingInterval) {
+  if (numThreads <= 0 || agingInterval <= 0) {
+    throw runtime_error("Thread count and aging interval must be positive!");
+  }
 
-  MMT[lruFrame].pageNumber = pageNum;
-  MMT[lruFrame].jobId = jobId;
-  MMT[lruFrame].busy = true;
+  SharedMemory mem(numFrames, 64 * numThreads);
+  initSharedMemory(mem, numJobs, pageSize, jobs, policy);
+  return runSharedCpus(mem, numJobs, numAccesses, numThreads, agingInterval);
+}
 
-  return lruFrame;
+// Thread counts 1, 2, 4, ... up to and including maxThreads
+vector<int> scalingThreadCounts(int maxThreads) {
+  vector<int> threadCounts;
+  for (int t = 1; t < maxThreads; t *= 2)
+    threadCounts.push_back(t);
+  threadCounts.push_back(maxThreads);
+  return threadCounts;
 }
 
-struct Stats {
-  int pageFrames{};
-  double failRatio{};
-  double successRatio{};
+// Runs the concurrent simulation at 1, 2, 4, ... up to maxThreads CPUs and
+// reports how fault handling and lock contention scale
+void printConcurrentScaling(int numJobs, int numFrames, int pageSize,
+                            int numAccesses, const vector<Job> &jobs,
+                            int maxThreads) {
+  for (auto policy : {ReplacementPolicy::Fifo, ReplacementPolicy::Lru,
+                      ReplacementPolicy::Clock}) {
+    printf("\n--- Concurrent CPUs (%s) ---\n", policyName(policy));
+    printf("Threads\tFaults\tFail Ratio\tAccesses/s\tFaults/s\tLock "
+           "Acquisitions\tContended\tLock Wait (ms)\tVictim Retries\tCAS "
+           "Retries\n");
+    for (int t : scalingThreadCounts(maxThreads)) {
+      auto cs = simulateConcurrentDemandPaging(
+          numJobs, numFrames, pageSize, numAccesses, jobs, policy, t, 1);
+      double contendedPct =
+          cs.lockAcquisitions
+              ? 100.0 * cs.contendedAcquisitions / cs.lockAcquisitions
+              : 0;
+      printf("%d\t%d\t%.2f\t\t%.0f\t\t%.0f\t\t%llu\t\t%.2f%%\t\t%.3f\t\t%d\t\t"
+             "%llu\n",
+             cs.threads, cs.pageFaults, cs.failRatio, cs.accessesPerSec,
+             cs.faultsPerSec, (unsigned long long)cs.lockAcquisitions,
+             contendedPct, cs.lockWaitSeconds * 1e3, cs.victimRetries,
+             (unsigned long long)cs.casRetries);
+    }
+  }
+}
+
+// Hit-path scaling benchmark: every page fits in memory, so after one warm-up
+// pass each CPU only takes hits. Compares the lock-free CLOCK path with the
+// locked LRU path in hits/sec per core.
+void printConcurrentHitScaling(int numJobs, int pageSize,
+                               const vector<Job> &jobs, int numAccesses,
+                               int maxThreads) {
+  int totalPages = 0;
+  for (const auto &job : jobs)
+    totalPages += (int)divideIntoPages(job, pageSize).first.size();
+
+  for (auto policy : {ReplacementPolicy::Clock, ReplacementPolicy::Lru}) {
+    printf("\n--- Concurrent Hit Path (%s) ---\n", policyName(policy));
+    printf("Threads\tHits/s\t\tHits/s/core\tScaling\n");
+    double singleCore = 0;
+    for (int t : scalingThreadCounts(maxThreads)) {
+      SharedMemory mem(totalPages, 64 * t);
+      initSharedMemory(mem, numJobs, pageSize, jobs, policy);
+      CpuStats warm;
+      for (int j = 0; j < numJobs; j++)
+        for (int p = 0; p < (int)mem.pages[j].size(); p++)
+          sharedAccess(mem, j, p, numAccesses, warm);
+
+      // Aging would turn the LRU benchmark into a frame scan benchmark
+      auto cs = runSharedCpus(mem, numJobs, numAccesses, t, numAccesses);
+      double perCore = cs.accessesPerSec / t;
+      if (t == 1)
+        singleCore = perCore;
+      printf("%d\t%.0f\t%.0f\t%.2fx\n", t, cs.accessesPerSec, perCore,
+             singleCore > 0 ? cs.accessesPerSec / singleCore : 0);
+    }
+  }
+}
+
+// Job state under local replacement: a job only ever evicts its own pages
+// and owns its frames outright, so jobs share nothing but the frame budget.
+// Each starts on its own cache line, so shards updating the counters of
+// neighbouring jobs do not false-share.
+struct alignas(64) LocalJob {
+  int id{};
+  PageMapTable PMT;
+  queue<int> fifoQueue; // Resident page numbers in load order
+  vector<int> freeFrames;
+  int quota{};
+  int resident{};
+  int pageFaults{};
+  int pageHits{};
+  int epochFaults{};
+};
+
+struct LocalStats {
   int numAccesses{};
   int pageFaults{};
   int pageHits{};
+  double failRatio{};
+  double seconds{};
+  int quotaMoves{};
+  int crossShardMoves{};
+  vector<int> jobFaults;
+  vector<int> jobHits;
+  vector<int> jobQuota;
 };
 
-// Demand Paging Simulation
-Stats simulateDemandPaging(int numJobs, int numFrames, int pageSize,
-                           int numAccesses, vector<Job> jobs,
-                           bool replacement) {
-  // Divide all jobs into pages
-  JobTable JT;
-  int totalPages = 0;
+// Builds the local replacement state, splitting the frames evenly between
+// jobs (every job needs at least one frame)
+vector<LocalJob> initLocalJobs(int numJobs, int numFrames, int pageSize,
+                               const vector<Job> &jobs) {
+  if (numFrames < numJobs) {
+    throw runtime_error(
+        "Local replacement needs at least one frame per job!");
+  }
 
-  printf("\n--- Dividing Jobs into Pages ---\n");
+  vector<LocalJob> local(numJobs);
   for (const auto &job : jobs) {
-    auto divRes = divideIntoPages(job, pageSize);
-    auto &pages = divRes.first;
-    auto &pmt = divRes.second;
-    JT[job.id].id = job.id;
-    JT[job.id].size = job.size;
-    JT[job.id].PMT = pmt;
+    local[job.id].id = job.id;
+    local[job.id].PMT = move(divideIntoPages(job, pageSize).second);
+  }
+  for (int frame = numFrames - 1; frame >= 0; frame--) {
+    auto &owner = local[frame % numJobs];
+    owner.freeFrames.push_back(frame);
+    owner.quota++;
+  }
+  return local;
+}
 
-    printf("\nJob %d divided into %zu pages:\n", job.id, pages.size());
-    for (const auto &page : pages) {
-      printf(" Page %d: %d K\n", page.id, page.size);
-      totalPages++;
+// Evicts the job's own FIFO or LRU victim and returns the freed frame
+int evictLocalVictim(LocalJob &job, ReplacementPolicy policy) {
+  int victim = -1;
+  if (policy == ReplacementPolicy::Fifo) {
+    victim = job.fifoQueue.front();
+    job.fifoQueue.pop();
+  } else {
+    uint64_t smallestRef = UINT64_MAX;
+    for (const auto &kv : job.PMT) {
+      if (kv.second.inMemory && kv.second.referenced < smallestRef) {
+        smallestRef = kv.second.referenced;
+        victim = kv.first;
+      }
     }
+  }
+  if (victim == -1) {
+    throw runtime_error("Local replacement: No page found for replacement!");
+  }
 
-    int internalFrag = pageSize - pages.back().size;
-    if (internalFrag > 0) {
-      printf(" Internal Fragmentation in last page: %d K\n", internalFrag);
-    }
+  auto &old = job.PMT[victim];
+  int frameNum = old.pageFrameId;
+  old.inMemory = false;
+  old.pageFrameId = -1;
+  old.referenced = 0;
+  job.resident--;
+  return frameNum;
+}
+
+// Services one access of a job under local replacement. Aging is per job:
+// a job's pages age only when the job itself runs.
+void localAccess(LocalJob &job, int pageNum, ReplacementPolicy policy) {
+  if (policy == ReplacementPolicy::Lru)
+    for (auto &kv : job.PMT)
+      if (kv.second.inMemory)
+        kv.second.referenced =
+            agedRegister(kv.second.referenced, DEFAULT_AGING_BITS);
+
+  auto &page = job.PMT[pageNum];
+  if (page.inMemory) {
+    job.pageHits++;
+    page.referenced |= AGING_MSB; // Set MSB on reference
+    return;
   }
 
-  printf("\nTotal pages across all jobs: %d\n", totalPages);
-  printf("Available memory frames: %d\n", numFrames);
+  job.pageFaults++;
+  job.epochFaults++;
+  int frameNum;
+  if (!job.freeFrames.empty()) {
+    frameNum = job.freeFrames.back();
+    job.freeFrames.pop_back();
+  } else {
+    frameNum = evictLocalVictim(job, policy);
+  }
 
-  // Initialize memory
-  MainMemory ram(numFrames);
-  MemoryMapTable MMT;
+  page.pageFrameId = frameNum;
+  page.inMemory = true;
+  page.referenced = AGING_MSB; // Set MSB on reference
+  job.resident++;
+  if (policy == ReplacementPolicy::Fifo)
+    job.fifoQueue.push(pageNum);
+}
 
-  for (int i = 0; i < numFrames; i++) {
-    ram[i].id = i;
-    ram[i].size = pageSize;
-    ram[i].startingAddr = i * pageSize;
+// Page-fault-frequency rebalancer, run between epochs: moves one frame from
+// the job that faulted least to the job that faulted most. Deterministic, so
+// any engine that rebalances at the same trace positions gets the same result.
+// Returns the donor and receiver, or {-1, -1} if nothing moved.
+pair<int, int> rebalanceLocalQuota(vector<LocalJob> &local,
+                                   ReplacementPolicy policy) {
+  int donor = -1, receiver = -1;
+  for (const auto &job : local) {
+    if (job.quota > 1 &&
+        (donor == -1 || job.epochFaults < local[donor].epochFaults))
+      donor = job.id;
+    if (receiver == -1 || job.epochFaults > local[receiver].epochFaults)
+      receiver = job.id;
+  }
+  bool skewed = donor != -1 && donor != receiver &&
+                local[receiver].epochFaults > local[donor].epochFaults;
+  for (auto &job : local)
+    job.epochFaults = 0;
+  if (!skewed)
+    return {-1, -1};
+
+  // Hand over a free frame, or evict one of the donor's pages to make one
+  auto &from = local[donor];
+  int frameNum;
+  if (!from.freeFrames.empty()) {
+    frameNum = from.freeFrames.back();
+    from.freeFrames.pop_back();
+  } else {
+    frameNum = evictLocalVictim(from, policy);
+  }
+  from.quota--;
+  local[receiver].freeFrames.push_back(frameNum);
+  local[receiver].quota++;
+  return {donor, receiver};
+}
 
-    MMT[i].pageFrameNumber = i;
-    MMT[i].pageNumber = -1;
-    MMT[i].jobId = -1;
-    MMT[i].busy = false;
+// Folds the per-job counters into LocalStats
+LocalStats collectLocalStats(const vector<LocalJob> &local, int numAccesses) {
+  LocalStats s;
+  s.numAccesses = numAccesses;
+  for (const auto &job : local) {
+    s.pageFaults += job.pageFaults;
+    s.pageHits += job.pageHits;
+    s.jobFaults.push_back(job.pageFaults);
+    s.jobHits.push_back(job.pageHits);
+    s.jobQuota.push_back(job.quota);
   }
+  s.failRatio = numAccesses ? (double)s.pageFaults / numAccesses : 0;
+  return s;
+}
 
-  printMMT(MMT);
+// Local-replacement Demand Paging Simulation over a trace, single-threaded,
+// rebalancing frame quotas every epochLength accesses
+LocalStats simulateLocalDemandPaging(int numJobs, int numFrames, int pageSize,
+                                     const vector<Job> &jobs,
+                                     const vector<Access> &trace,
+                                     ReplacementPolicy policy,
+                                     int epochLength) {
+  if (policy == ReplacementPolicy::Clock) {
+    throw runtime_error("Local replacement supports FIFO and LRU only!");
+  }
+  auto local = initLocalJobs(numJobs, numFrames, pageSize, jobs);
+
+  int quotaMoves = 0;
+  auto start = chrono::steady_clock::now();
+  for (size_t i = 0; i < trace.size(); i++) {
+    localAccess(local[trace[i].jobId], trace[i].pageNumber, policy);
+    if ((i + 1) % epochLength == 0 &&
+        rebalanceLocalQuota(local, policy).first != -1)
+      quotaMoves++;
+  }
+  double seconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-  // Simulate page requests (demand paging)
-  printf("\n--- Simulating Demand Paging ---\n");
-  printf("Pages are loaded into memory only when accessed.\n\n");
+  auto s = collectLocalStats(local, (int)trace.size());
+  s.seconds = seconds;
+  s.quotaMoves = quotaMoves;
+  return s;
+}
 
-  int pageFaults = 0;
-  queue<int> fifoQueue;
-  int pageHits = 0;
+// Reusable barrier; the last thread to arrive runs onComplete before the
+// others are released
+class Barrier {
+public:
+  Barrier(int count, function<void()> onComplete)
+      : count(count), remaining(count), onComplete(move(onComplete)) {}
+
+  void wait() {
+    unique_lock<mutex> lk(m);
+    auto gen = generation;
+    if (--remaining == 0) {
+      onComplete();
+      generation++;
+      remaining = count;
+      cv.notify_all();
+    } else {
+      cv.wait(lk, [&] { return gen != generation; });
+    }
+  }
+
+private:
+  mutex m;
+  condition_variable cv;
+  int count;
+  int remaining;
+  uint64_t generation{};
+  function<void()> onComplete;
+};
+
+// Job-sharded local-replacement simulation: jobs are partitioned across
+// numShards worker threads, each owning its jobs' PMTs and frames. Shards run
+// an epoch in parallel, then the rebalancer moves quota between them while
+// they wait, so the result matches simulateLocalDemandPaging exactly.
+LocalStats simulateShardedDemandPaging(int numJobs, int numFrames,
+                                       int pageSize, const vector<Job> &jobs,
+                                       const vector<Access> &trace,
+                                       ReplacementPolicy policy,
+                                       int epochLength, int numShards) {
+  if (policy == ReplacementPolicy::Clock) {
+    throw runtime_error("Local replacement supports FIFO and LRU only!");
+  }
+  if (numShards <= 0) {
+    throw runtime_error("Shard count must be positive!");
+  }
+  auto local = initLocalJobs(numJobs, numFrames, pageSize, jobs);
+
+  // Split the trace by shard, remembering where each epoch ends
+  int numEpochs = ((int)trace.size() + epochLength - 1) / epochLength;
+  vector<vector<Access>> shardTrace(numShards);
+  vector<vector<size_t>> epochEnds(numShards, vector<size_t>(numEpochs));
+  for (size_t i = 0; i < trace.size(); i++) {
+    shardTrace[trace[i].jobId % numShards].push_back(trace[i]);
+    if ((i + 1) % epochLength == 0 || i + 1 == trace.size())
+      for (int shard = 0; shard < numShards; shard++)
+        epochEnds[shard][i / epochLength] = shardTrace[shard].size();
+  }
+
+  int quotaMoves = 0, crossShardMoves = 0, epoch = 0;
+  Barrier epochBarrier(numShards, [&] {
+    // Only full epochs rebalance, as in the single-threaded run
+    if ((size_t)(epoch + 1) * epochLength <= trace.size()) {
+      auto moved = rebalanceLocalQuota(local, policy);
+      if (moved.first != -1) {
+        quotaMoves++;
+        if (moved.first % numShards != moved.second % numShards)
+          crossShardMoves++;
+      }
+    }
+    epoch++;
+  });
+
+  auto runShard = [&](int shard) {
+    size_t next = 0;
+    for (int e = 0; e < numEpochs; e++) {
+      for (; next < epochEnds[shard][e]; next++) {
+        const auto &a = shardTrace[shard][next];
+        localAccess(local[a.jobId], a.pageNumber, policy);
+      }
+      epochBarrier.wait();
+    }
+  };
+
+  auto start = chrono::steady_clock::now();
+  vector<thread> workers;
+  for (int shard = 1; shard < numShards; shard++)
+    workers.emplace_back(runShard, shard);
+  runShard(0);
+  for (auto &worker : workers)
+    worker.join();
+  double seconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  auto s = collectLocalStats(local, (int)trace.size());
+  s.seconds = seconds;
+  s.quotaMoves = quotaMoves;
+  s.crossShardMoves = crossShardMoves;
+  return s;
+}
+
+// Compares sharded runs at 1, 2, 4, ... up to maxShards against the
+// single-threaded local-replacement run on the same trace
+void printShardedScaling(int numJobs, int numFrames, int pageSize,
+                         int numAccesses, const vector<Job> &jobs,
+                         int maxShards) {
   random_device rnd;
-  mt19937 gen(rnd());
-  uniform_int_distribution<> jobDist(0, numJobs - 1);
+  auto trace =
+      generateTrace(pagesPerJob(numJobs, pageSize, jobs), numAccesses, rnd());
+  int epochLength = max(4096, numAccesses / 64);
+
+  for (auto policy : {ReplacementPolicy::Fifo, ReplacementPolicy::Lru}) {
+    auto base = simulateLocalDemandPaging(numJobs, numFrames, pageSize, jobs,
+                                          trace, policy, epochLength);
+    printf("\n--- Sharded Local Replacement (%s) ---\n", policyName(policy));
+    printf("Single-threaded: %d faults, fail ratio %.2f, %d quota moves, "
+           "%.3f s\n",
+           base.pageFaults, base.failRatio, base.quotaMoves, base.seconds);
+    printf("Shards\tFaults\tSeconds\tSpeedup\tQuota Moves\tCross-Shard\t"
+           "Matches\n");
+    for (int shards : scalingThreadCounts(maxShards)) {
+      auto s = simulateShardedDemandPaging(numJobs, numFrames, pageSize, jobs,
+                                           trace, policy, epochLength, shards);
+      bool matches = s.jobFaults == base.jobFaults &&
+                     s.jobHits == base.jobHits && s.jobQuota == base.jobQuota;
+      printf("%d\t%d\t%.3f\t%.2fx\t%d\t\t%d\t\t%s\n", shards, s.pageFaults,
+             s.seconds, s.seconds > 0 ? base.seconds / s.seconds : 0,
+             s.quotaMoves, s.crossShardMoves, matches ? "yes" : "NO");
+    }
 
-  for (int access = 0; access < numAccesses; access++) {
-    // Randomly select a job and page
-    int jobId = jobDist(gen);
-    auto &job = JT[jobId];
-    vector<int> pageKeys;
-    for (const auto &kv : job.PMT)
-      pageKeys.push_back(kv.first);
-    if (pageKeys.empty())
-      continue;
-    uniform_int_distribution<> pageDist(0, (int)pageKeys.size() - 1);
-    int pageNum = pageKeys[pageDist(gen)];
+    printf("Job\tFaults\tHits\tFinal Quota\n");
+    for (int j = 0; j < numJobs; j++)
+      printf("%d\t%d\t%d\t%d\n", j, base.jobFaults[j], base.jobHits[j],
+             base.jobQuota[j]);
+  }
+}
 
-    printf("Access %d: J%d, P%d : ", access + 1, jobId, pageNum);
+// Per-worker accounting of a WorkStealingPool
+struct WorkerStats {
+  uint64_t tasks{};
+  uint64_t steals{};
+  double busySeconds{};
+};
 
-    auto &PMT = JT[jobId].PMT;
-    auto &page = PMT[pageNum];
+// Work-stealing task pool. Each worker owns a deque: it pops its newest task
+// from the back and, once empty, steals the oldest task from the front of
+// another worker's deque, so long tasks never hold short ones hostage. Idle
+// workers sleep until a task is submitted. The first exception a task throws
+// is kept and rethrown by wait().
+class WorkStealingPool {
+public:
+  explicit WorkStealingPool(int numWorkers) : workers(numWorkers) {
+    if (numWorkers <= 0) {
+      throw runtime_error("Worker count must be positive!");
+    }
+    for (auto &w : workers)
+      w.reset(new Worker);
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < numWorkers; i++)
+      threads.emplace_back(&WorkStealingPool::run, this, i);
+  }
 
-    // Age all pages' referenced bits (for LRU)
-    for (auto &kv : JT)
-      for (auto &pkv : kv.second.PMT)
-        if (pkv.second.inMemory)
-          pkv.second.referenced >>= 1; // Shift right one bit
+  ~WorkStealingPool() {
+    {
+      lock_guard<mutex> lk(idleLock);
+      stopping = true;
+    }
+    idle.notify_all();
+    for (auto &t : threads)
+      t.join();
+  }
 
-    // Check if page is in memory
-    if (page.inMemory) {
-      printf("HIT\n");
-      pageHits++;
-      page.referenced |= 0x80; // Set MSB on reference
+  // Queues a task, spreading submissions round-robin over the deques
+  void submit(function<void()> task) {
+    auto &w = *workers[nextWorker++ % workers.size()];
+    {
+      lock_guard<mutex> lk(w.lock);
+      w.tasks.push_back(move(task));
+    }
+    {
+      lock_guard<mutex> lk(idleLock);
+      pending++;
+      queued++;
+    }
+    idle.notify_one();
+  }
 
-    } else {
-      printf("FAULT\n");
-      pageFaults++;
-
-      // Find an empty frame
-      int emptyFrame = -1;
-      for (int i = 0; i < numFrames; i++) {
-        if (!MMT[i].busy) {
-          emptyFrame = i;
-          break;
+  // Blocks until every submitted task has finished, then rethrows the first
+  // exception any of them threw
+  void wait() {
+    unique_lock<mutex> lk(idleLock);
+    done.wait(lk, [&] { return pending == 0; });
+    if (error) {
+      auto e = error;
+      error = nullptr;
+      rethrow_exception(e);
+    }
+  }
+
+  // Worker counters plus the pool's lifetime so far, for utilization
+  vector<WorkerStats> stats() const {
+    vector<WorkerStats> res;
+    for (const auto &w : workers) {
+      lock_guard<mutex> lk(w->lock);
+      res.push_back(w->stats);
+    }
+    return res;
+  }
+
+  double elapsedSeconds() const {
+    return chrono::duration<double>(chrono::steady_clock::now() - start)
+        .count();
+  }
+
+  int size() const { return (int)workers.size(); }
+
+private:
+  struct Worker {
+    mutable mutex lock;
+    deque<function<void()>> tasks;
+    WorkerStats stats;
+  };
+
+  // Pops from our own deque, then tries to steal from the others
+  bool takeTask(int self, function<void()> &task, bool &stolen) {
+    auto &own = *workers[self];
+    {
+      lock_guard<mutex> lk(own.lock);
+      if (!own.tasks.empty()) {
+        task = move(own.tasks.back());
+        own.tasks.pop_back();
+        queued--;
+        stolen = false;
+        return true;
+      }
+    }
+    for (size_t i = 1; i < workers.size(); i++) {
+      auto &victim = *workers[(self + i) % workers.size()];
+      lock_guard<mutex> lk(victim.lock);
+      if (!victim.tasks.empty()) {
+        task = move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queued--;
+        stolen = true;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void run(int self) {
+    auto &own = *workers[self];
+    for (;;) {
+      function<void()> task;
+      bool stolen = false;
+      if (takeTask(self, task, stolen)) {
+        auto begin = chrono::steady_clock::now();
+        exception_ptr failure;
+        try {
+          task();
+        } catch (...) {
+          failure = current_exception();
+        }
+        double busy =
+            chrono::duration<double>(chrono::steady_clock::now() - begin)
+                .count();
+        {
+          lock_guard<mutex> lk(own.lock);
+          own.stats.tasks++;
+          own.stats.steals += stolen;
+          own.stats.busySeconds += busy;
+        }
+        lock_guard<mutex> lk(idleLock);
+        if (failure && !error)
+          error = failure;
+        if (--pending == 0) {
+          done.notify_all();
+          idle.notify_all(); // Lets the others stop
         }
+        continue;
       }
 
-      if (emptyFrame != -1) {
-        // Load page into empty frame
-        page.pageFrameId = emptyFrame;
-        page.inMemory = true;
-        page.referenced = 0x80; // Set MSB on reference
+      // A queued task we failed to take is being taken by another worker,
+      // which decrements queued outside idleLock once it has it, so waking
+      // with queued back at zero is no reason to stop; only shutdown is
+      unique_lock<mutex> lk(idleLock);
+      idle.wait(lk, [&] { return queued > 0 || (stopping && pending == 0); });
+      if (stopping && pending == 0)
+        return;
+    }
+  }
 
-        MMT[emptyFrame].pageNumber = pageNum;
-        MMT[emptyFrame].jobId = jobId;
-        MMT[emptyFrame].busy = true;
+  vector<unique_ptr<Worker>> workers;
+  vector<thread> threads;
+  atomic<size_t> nextWorker{0};
+  mutex idleLock;
+  condition_variable idle;
+  condition_variable done;
+  int pending{}; // Submitted and not yet finished
+  // Submitted and not yet taken; raised under idleLock so that a sleeping
+  // worker cannot miss it
+  atomic<int> queued{0};
+  exception_ptr error;
+  bool stopping{};
+  chrono::steady_clock::time_point start;
+};
 
-        fifoQueue.push(emptyFrame);
-        printf("\tLoaded F%d\n", emptyFrame);
-      } else {
-        if (replacement) {
-          FIFO(JT, MMT, fifoQueue, jobId, pageNum, pageSize);
-        } else {
-          LRU(JT, MMT, jobId, pageNum, pageSize);
+// Prints how busy each worker of a pool was over its lifetime
+void printWorkerUtilization(const WorkStealingPool &pool) {
+  double elapsed = pool.elapsedSeconds();
+  printf("\nWorker\tTasks\tSteals\tBusy (s)\tUtilization\n");
+  auto stats = pool.stats();
+  for (size_t i = 0; i < stats.size(); i++) {
+    printf("%zu\t%llu\t%llu\t%.3f\t\t%.1f%%\n", i,
+           (unsigned long long)stats[i].tasks,
+           (unsigned long long)stats[i].steals, stats[i].busySeconds,
+           elapsed > 0 ? 100.0 * stats[i].busySeconds / elapsed : 0);
+  }
+}
+
+// Frame-count sweep: every frame count from 1 doubling up to maxFrames, under
+// global FIFO and LRU and local FIFO and LRU, all over the same trace. The
+// points differ in cost by orders of magnitude, so they run as tasks on a
+// work-stealing pool.
+void printFrameSweep(int numJobs, int maxFrames, int pageSize,
+                     int numAccesses, const vector<Job> &jobs,
+                     int numWorkers) {
+  random_device rnd;
+  auto trace =
+      generateTrace(pagesPerJob(numJobs, pageSize, jobs), numAccesses, rnd());
+  auto frameCounts = scalingThreadCounts(maxFrames);
+  int epochLength = max(4096, numAccesses / 64);
+
+  // Results by point then column: global FIFO, global LRU, local FIFO/LRU
+  const int numColumns = 4;
+  vector<double> failRatios(frameCounts.size() * numColumns, -1);
+
+  WorkStealingPool pool(numWorkers);
+  for (size_t p = 0; p < frameCounts.size(); p++) {
+    int frames = frameCounts[p];
+    double *row = &failRatios[p * numColumns];
+    pool.submit([=, &jobs, &trace] {
+      row[0] = simulateDemandPagingTrace(frames, pageSize, jobs, trace,
+                                         ReplacementPolicy::Fifo, false)
+                   .failRatio;
+    });
+    pool.submit([=, &jobs, &trace] {
+      row[1] = simulateDemandPagingTrace(frames, pageSize, jobs, trace,
+                                         ReplacementPolicy::Lru, false)
+                   .failRatio;
+    });
+    if (frames < numJobs)
+      continue;
+    pool.submit([=, &jobs, &trace] {
+      row[2] = simulateLocalDemandPaging(numJobs, frames, pageSize, jobs,
+                                         trace, ReplacementPolicy::Fifo,
+                                         epochLength)
+                   .failRatio;
+    });
+    pool.submit([=, &jobs, &trace] {
+      row[3] = simulateLocalDemandPaging(numJobs, frames, pageSize, jobs,
+                                         trace, ReplacementPolicy::Lru,
+                                         epochLength)
+                   .failRatio;
+    });
+  }
+  pool.wait();
+
+  printf("\n--- Frame Sweep (fail ratio) ---\n");
+  printf("Frames\tFIFO\tLRU\tLocal FIFO\tLocal LRU\n");
+  for (size_t p = 0; p < frameCounts.size(); p++) {
+    printf("%d", frameCounts[p]);
+    for (int c = 0; c < numColumns; c++) {
+      double ratio = failRatios[p * numColumns + c];
+      printf(c == 3 ? "\t\t" : "\t");
+      if (ratio < 0)
+        printf("-");
+      else
+        printf("%.3f", ratio);
+    }
+    printf("\n");
+  }
+  printWorkerUtilization(pool);
+}
+
+// Runs FIFO, LRU and CLOCK on a NUMA machine over one trace, without and
+// with NUMA balancing, reporting local/remote ratios and modeled latency.
+// The six runs are independent, so they share a work-stealing pool.
+void printNumaComparison(int numJobs, int numFrames, int pageSize,
+                         int numAccesses, const vector<Job> &jobs,
+                         int numNodes, double remoteCost) {
+  random_device rnd;
+  auto trace =
+      generateTrace(pagesPerJob(numJobs, pageSize, jobs), numAccesses, rnd());
+
+  vector<pair<ReplacementPolicy, bool>> runs;
+  for (auto policy : {ReplacementPolicy::Fifo, ReplacementPolicy::Lru,
+                      ReplacementPolicy::Clock})
+    for (bool balancing : {false, true})
+      runs.push_back({policy, balancing});
+  vector<Stats> stats(runs.size());
+  {
+    WorkStealingPool pool((int)max(1u, thread::hardware_concurrency()));
+    for (size_t r = 0; r < runs.size(); r++)
+      pool.submit([&, r] {
+        DemandPagingEngine e;
+        initEngine(e, numFrames, pageSize, jobs, runs[r].first, false);
+        configureNuma(e, numNodes, remoteCost, runs[r].second);
+        for (const auto &a : trace)
+          engineAccess(e, a.jobId, a.pageNumber);
+        if (!numaQueuesConsistent(e)) {
+          throw runtime_error("NUMA: node queues lost track of the frames!");
         }
+        stats[r] = engineStats(e);
+      });
+    pool.wait();
+  }
+
+  printf("\n--- NUMA Memory Model (%d nodes, remote %.2fx) ---\n", numNodes,
+         remoteCost);
+  printf("Policy\tBalancing\tFaults\tFail Ratio\tLocal\tRemote\tLocal "
+         "Ratio\tMigrations\tAvg Latency (ns)\n");
+  for (size_t r = 0; r < runs.size(); r++) {
+    const auto &s = stats[r];
+    printf("%s\t%s\t\t%lld\t%.2f\t\t%lld\t%lld\t%.2f\t\t%lld\t\t%.1f\n",
+           policyName(runs[r].first), runs[r].second ? "on" : "off",
+           (long long)s.pageFaults, s.failRatio, (long long)s.localAccesses,
+           (long long)s.remoteAccesses,
+           (double)s.localAccesses / s.numAccesses, (long long)s.migrations,
+           s.modeledLatencyNs / s.numAccesses);
+  }
+}
+
+// Unattended batch run, configured by command-line flags and config files
+// instead of prompts. Every policy runs at every frame count on the trace
+// of every seed.
+struct BatchConfig {
+  int pageSize{};
+  int numJobs{};
+  vector<int> jobSizes;  // Explicit job sizes, or
+  string jobSizeDist;    // a file of "size [weight]" lines to draw them from
+  vector<int> frameCounts;
+  int64_t numAccesses{};
+  vector<ReplacementPolicy> policies{ReplacementPolicy::Fifo,
+                                     ReplacementPolicy::Lru};
+  vector<unsigned> seeds{1};
+  bool seedsGiven{};
+  string format{"text"}; // text, csv or json
+  string output;         // File to write results to instead of stdout
+  bool policiesGiven{};
+  int agingBits{}; // LRU aging register width; 0 for the engine's default
+
+  // Checkpointed single run: written every checkpointEvery accesses and at
+  // the end, or resumed from resumePath
+  string checkpointPath;
+  int64_t checkpointEvery{};
+  string resumePath;
+
+  // Service mode: answer queries on this Unix socket with numWorkers
+  // simulation threads
+  string servePath;
+  int numWorkers{};
+
+  // Config files being read, innermost last, to catch include cycles
+  vector<string> openConfigs;
+};
+
+// Config files may include each other this deep, which also stops cycles
+// that name a file two different ways
+const size_t MAX_CONFIG_DEPTH = 16;
+
+const char *BATCH_USAGE =
+    "Usage: %s [--mem-report] [--config FILE] [options]\n"
+    "Without options, prompts for everything interactively.\n"
+    "Options (also valid as \"key = value\" lines in a config file):\n"
+    "  --page-size N\n"
+    "  --jobs N                 number of jobs\n"
+    "  --job-sizes A,B,...      job sizes (a single size is used for all)\n"
+    "  --job-size-dist FILE     draw job sizes from \"size [weight]\" lines\n"
+    "  --frames A,B,...         frame counts to simulate\n"
+    "  --accesses N\n"
+    "  --policies fifo,lru,clock\n"
+    "  --seeds A,B,...\n"
+    "  --format text|csv|json\n"
+    "  --output FILE\n"
+    "  --aging-bits 8|16|32|64  LRU aging register width (default 8)\n"
+    "Checkpointed runs (one policy, frame count and seed):\n"
+    "  --checkpoint FILE        save the engine state to FILE\n"
+    "  --checkpoint-every N     ... every N accesses as well as at the end\n"
+    "  --resume FILE            continue from a checkpoint; --accesses sets\n"
+    "                           the new total, --policies one policy to\n"
+    "                           branch to; the page size, jobs, frames,\n"
+    "                           seed and aging width come from the\n"
+    "                           checkpoint\n"
+    "Service mode (the jobs and one trace per seed are loaded once):\n"
+    "  --serve SOCKET           answer queries on a Unix domain socket\n"
+    "  --workers N              simulation threads (default: one per CPU)\n"
+    "  Requests are 16 bytes: u32 id, policy (0 FIFO, 1 LRU, 2 CLOCK),\n"
+    "  frames, seed. Responses are 24 bytes: u32 id, status (0 ok, 1 bad\n"
+    "  request, 2 failed), faults, hits, f64 fail ratio. All little-endian;\n"
+    "  requests may be pipelined and responses arrive as they finish.\n";
+
+vector<string> splitList(const string &value) {
+  vector<string> res;
+  size_t start = 0;
+  for (;;) {
+    size_t comma = value.find(',', start);
+    res.push_back(value.substr(start, comma - start));
+    if (comma == string::npos)
+      return res;
+    start = comma + 1;
+  }
+}
+
+// An integer option value of at least min (0 or 1) and at most max
+long long parseInteger(const string &key, const string &value, long long min,
+                       long long max) {
+  size_t used = 0;
+  long long n = -1;
+  try {
+    n = stoll(value, &used);
+  } catch (const exception &) {
+  }
+  if (used != value.size() || n < min) {
+    throw runtime_error(key + " must be a " +
+                        (min > 0 ? "positive" : "non-negative") +
+                        " integer, got \"" + value + "\"");
+  }
+  if (n > max) {
+    throw runtime_error(key + " must be at most " + to_string(max) +
+                        ", got \"" + value + "\"");
+  }
+  return n;
+}
+
+// A positive integer option value of at most max
+long long parsePositive(const string &key, const string &value,
+                        long long max = INT_MAX) {
+  return parseInteger(key, value, 1, max);
+}
+
+ReplacementPolicy parsePolicy(const string &name) {
+  string lower;
+  for (char c : name)
+    lower += (char)tolower((unsigned char)c);
+  if (lower == "fifo")
+    return ReplacementPolicy::Fifo;
+  if (lower == "lru")
+    return ReplacementPolicy::Lru;
+  if (lower == "clock")
+    return ReplacementPolicy::Clock;
+  throw runtime_error("Unknown replacement policy \"" + name + "\"");
+}
+
+void loadBatchConfigFile(BatchConfig &c, const string &path);
+
+// Applies one option; key is the flag without its leading dashes
+void applyBatchOption(BatchConfig &c, const string &key, const string &value) {
+  if (key == "config") {
+    loadBatchConfigFile(c, value);
+  } else if (key == "page-size") {
+    c.pageSize = (int)parsePositive(key, value);
+  } else if (key == "jobs") {
+    c.numJobs = (int)parsePositive(key, value);
+  } else if (key == "job-sizes") {
+    c.jobSizes.clear();
+    for (const auto &v : splitList(value))
+      c.jobSizes.push_back((int)parsePositive(key, v));
+  } else if (key == "job-size-dist") {
+    c.jobSizeDist = value;
+  } else if (key == "frames") {
+    c.frameCounts.clear();
+    for (const auto &v : splitList(value))
+      c.frameCounts.push_back((int)parsePositive(key, v));
+  } else if (key == "accesses") {
+    c.numAccesses = parsePositive(key, value, LLONG_MAX);
+  } else if (key == "policies") {
+    c.policies.clear();
+    for (const auto &v : splitList(value))
+      c.policies.push_back(parsePolicy(v));
+    c.policiesGiven = true;
+  } else if (key == "seeds") {
+    c.seeds.clear();
+    for (const auto &v : splitList(value))
+      c.seeds.push_back((unsigned)parseInteger(key, v, 0, UINT_MAX));
+    c.seedsGiven = true;
+  } else if (key == "format") {
+    if (value != "text" && value != "csv" && value != "json") {
+      throw runtime_error("Unknown output format \"" + value + "\"");
+    }
+    c.format = value;
+  } else if (key == "output") {
+    c.output = value;
+  } else if (key == "aging-bits") {
+    c.agingBits = (int)parsePositive(key, value, 64);
+    if (!validAgingBits(c.agingBits)) {
+      throw runtime_error(key + " must be 8, 16, 32 or 64, got \"" + value +
+                          "\"");
+    }
+  } else if (key == "checkpoint") {
+    c.checkpointPath = value;
+  } else if (key == "checkpoint-every") {
+    c.checkpointEvery = parsePositive(key, value, LLONG_MAX);
+  } else if (key == "resume") {
+    c.resumePath = value;
+  } else if (key == "serve") {
+    c.servePath = value;
+  } else if (key == "workers") {
+    c.numWorkers = (int)parsePositive(key, value);
+  } else {
+    throw runtime_error("Unknown option \"" + key + "\"");
+  }
+}
+
+string trim(const string &s) {
+  size_t first = s.find_first_not_of(" \t\r");
+  if (first == string::npos)
+    return "";
+  return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+// Reads "key = value" lines; # starts a comment
+void loadBatchConfigFile(BatchConfig &c, const string &path) {
+  if (find(c.openConfigs.begin(), c.openConfigs.end(), path) !=
+      c.openConfigs.end()) {
+    throw runtime_error("Config file " + path + " includes itself");
+  }
+  if (c.openConfigs.size() >= MAX_CONFIG_DEPTH) {
+    throw runtime_error("Config files nested more than " +
+                        to_string(MAX_CONFIG_DEPTH) + " deep at " + path);
+  }
+  ifstream in(path);
+  if (!in) {
+    throw runtime_error("Cannot open config file " + path);
+  }
+  c.openConfigs.push_back(path);
+  string line;
+  for (int lineNo = 1; getline(in, line); lineNo++) {
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty())
+      continue;
+    size_t eq = line.find('=');
+    if (eq == string::npos) {
+      throw runtime_error(path + ":" + to_string(lineNo) +
+                          ": expected \"key = value\"");
+    }
+    applyBatchOption(c, trim(line.substr(0, eq)), trim(line.substr(eq + 1)));
+  }
+  c.openConfigs.pop_back();
+}
+
+// Parses the command line into c; returns false if there is nothing to run
+// unattended
+bool parseBatchArgs(int argc, char **argv, BatchConfig &c) {
+  bool batch = false;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "--mem-report") {
+      memReportEnabled = true;
+      continue;
+    }
+    if (arg.compare(0, 2, "--") != 0) {
+      throw runtime_error("Unexpected argument \"" + arg + "\"");
+    }
+    string key = arg.substr(2), value;
+    size_t eq = key.find('=');
+    if (eq != string::npos) {
+      value = key.substr(eq + 1);
+      key = key.substr(0, eq);
+    } else if (i + 1 < argc) {
+      value = argv[++i];
+    } else {
+      throw runtime_error("Missing value for " + arg);
+    }
+    applyBatchOption(c, key, value);
+    batch = true;
+  }
+  return batch;
+}
+
+// Job sizes drawn with the first seed from a distribution file of
+// "size [weight]" lines (weight 1 if missing)
+vector<int> drawJobSizes(const string &path, int numJobs, unsigned seed) {
+  ifstream in(path);
+  if (!in) {
+    throw runtime_error("Cannot open job size distribution " + path);
+  }
+  vector<int> sizes;
+  vector<double> weights;
+  string line;
+  while (getline(in, line)) {
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty())
+      continue;
+    stringstream ss(line);
+    int size;
+    double weight = 1;
+    if (!(ss >> size) || size <= 0 || ((ss >> weight), weight < 0)) {
+      throw runtime_error("Bad job size line in " + path + ": " + line);
+    }
+    sizes.push_back(size);
+    weights.push_back(weight);
+  }
+  if (sizes.empty()) {
+    throw runtime_error("Job size distribution " + path + " is empty!");
+  }
+  mt19937 gen(seed);
+  discrete_distribution<> pick(weights.begin(), weights.end());
+  vector<int> res(numJobs);
+  for (auto &size : res)
+    size = sizes[pick(gen)];
+  return res;
+}
+
+vector<Job> batchJobs(const BatchConfig &c) {
+  vector<int> sizes;
+  if (!c.jobSizeDist.empty()) {
+    if (c.numJobs <= 0) {
+      throw runtime_error("--job-size-dist needs --jobs");
+    }
+    sizes = drawJobSizes(c.jobSizeDist, c.numJobs, c.seeds.front());
+  } else if (c.jobSizes.size() == 1 && c.numJobs > 0) {
+    sizes.assign(c.numJobs, c.jobSizes.front());
+  } else {
+    sizes = c.jobSizes;
+    if (c.numJobs > 0 && (int)sizes.size() != c.numJobs) {
+      throw runtime_error("--jobs does not match the number of --job-sizes");
+    }
+  }
+  if (sizes.empty()) {
+    throw runtime_error("No jobs: give --job-sizes or --job-size-dist");
+  }
+  vector<Job> jobs(sizes.size());
+  for (size_t i = 0; i < jobs.size(); i++)
+    jobs[i] = {(int)i, sizes[i]};
+  return jobs;
+}
+
+// Opens the batch output and writes the header of its format
+FILE *openBatchOutput(const BatchConfig &c) {
+  FILE *out = stdout;
+  if (!c.output.empty() && !(out = fopen(c.output.c_str(), "w"))) {
+    throw runtime_error("Cannot open output file " + c.output);
+  }
+  if (c.format == "csv")
+    fprintf(out, "policy,frames,seed,jobs,accesses,faults,hits,fail_ratio,"
+                 "wall_seconds,accesses_per_sec\n");
+  else if (c.format == "json")
+    fprintf(out, "[");
+  else
+    fprintf(out, "Policy\tFrames\tSeed\tFaults\tHits\tFail Ratio\t"
+                 "Accesses/sec\n");
+  return out;
+}
+
+// Writes one run's result; first tells JSON whether a comma is needed
+void printBatchResult(FILE *out, const BatchConfig &c, bool first,
+                      ReplacementPolicy policy, unsigned seed, int numJobs,
+                      const Stats &s) {
+  const char *name = policyName(policy);
+  auto accesses = (long long)s.numAccesses;
+  auto faults = (long long)s.pageFaults;
+  auto hits = (long long)s.pageHits;
+  if (c.format == "csv")
+    fprintf(out, "%s,%d,%u,%d,%lld,%lld,%lld,%.6f,%.6f,%.0f\n", name,
+            s.pageFrames, seed, numJobs, accesses, faults, hits, s.failRatio,
+            s.wallSeconds, s.accessesPerSec);
+  else if (c.format == "json")
+    fprintf(out,
+            "%s\n  {\"policy\": \"%s\", \"frames\": %d, \"seed\": %u, "
+            "\"jobs\": %d, \"accesses\": %lld, \"faults\": %lld, "
+            "\"hits\": %lld, \"fail_ratio\": %.6f, "
+            "\"wall_seconds\": %.6f, \"accesses_per_sec\": %.0f}",
+            first ? "" : ",", name, s.pageFrames, seed, numJobs, accesses,
+            faults, hits, s.failRatio, s.wallSeconds, s.accessesPerSec);
+  else
+    fprintf(out, "%s\t%d\t%u\t%lld\t%lld\t%.4f\t\t%.0f\n", name,
+            s.pageFrames, seed, faults, hits, s.failRatio, s.accessesPerSec);
+  if (memReportEnabled)
+    printMemoryReport(out, s);
+}
+
+void closeBatchOutput(const BatchConfig &c, FILE *out) {
+  if (c.format == "json")
+    fprintf(out, "\n]\n");
+  if (memReportEnabled)
+    printMemoryPeaks(out);
+  if (out != stdout && fclose(out) != 0) {
+    throw runtime_error("Cannot write output file " + c.output);
+  }
+}
+
+// One run fed by a trace generator, checkpointed as configured. A resumed
+// run takes its jobs, frames and trace from the checkpoint; a different
+// policy there branches the warmed-up state.
+void runCheckpointed(const BatchConfig &c) {
+  DemandPagingEngine e;
+  TraceGenerator tg({}, 0, 0);
+  unsigned seed;
+  if (!c.resumePath.empty()) {
+    if (c.pageSize > 0 || c.numJobs > 0 || !c.jobSizes.empty() ||
+        !c.jobSizeDist.empty() || !c.frameCounts.empty() || c.seedsGiven ||
+        c.agingBits > 0) {
+      throw runtime_error("A resumed run takes its page size, jobs, frames, "
+                          "seed and aging width from the checkpoint");
+    }
+    seed = loadCheckpoint(c.resumePath, e, tg);
+    if (c.policiesGiven) {
+      if (c.policies.size() != 1) {
+        throw runtime_error("A resumed run takes a single policy");
       }
+      e.policy = c.policies.front();
+    }
+    if (c.numAccesses > 0)
+      tg.remaining = max<int64_t>(0, c.numAccesses - e.numAccesses);
+  } else {
+    if (c.pageSize <= 0 || c.numAccesses <= 0 || c.policies.size() != 1 ||
+        c.frameCounts.size() != 1 || c.seeds.size() != 1) {
+      throw runtime_error("Checkpointed runs need --page-size, --accesses "
+                          "and one policy, frame count and seed");
     }
+    auto jobs = batchJobs(c);
+    seed = c.seeds.front();
+    initEngine(e, c.frameCounts.front(), c.pageSize, jobs,
+               c.policies.front(), false);
+    if (c.agingBits > 0)
+      configureAging(e, c.agingBits);
+    tg = TraceGenerator(pagesPerJob((int)jobs.size(), c.pageSize, jobs),
+                        c.numAccesses, seed);
   }
 
-  // Print final state
-  printMMT(MMT);
-  for (const auto &kv : JT) {
-    printf("Final PMT for Job %d:\n", kv.first);
-    printPMT(kv.second.PMT);
+  auto start = chrono::steady_clock::now();
+  int64_t startAccesses = e.numAccesses;
+  while (tg.remaining > 0) {
+    auto a = nextAccess(tg);
+    engineAccess(e, a.jobId, a.pageNumber);
+    if (c.checkpointEvery > 0 && !c.checkpointPath.empty() &&
+        e.numAccesses % c.checkpointEvery == 0)
+      saveCheckpoint(c.checkpointPath, e, tg, seed);
   }
+  if (!c.checkpointPath.empty())
+    saveCheckpoint(c.checkpointPath, e, tg, seed);
+
+  auto s = engineStats(e);
+  s.wallSeconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  s.accessesPerSec = s.wallSeconds > 0
+                         ? (e.numAccesses - startAccesses) / s.wallSeconds
+                         : 0;
+  FILE *out = openBatchOutput(c);
+  printBatchResult(out, c, true, e.policy, seed, (int)e.JT.size(), s);
+  closeBatchOutput(c, out);
+}
 
-  double failRatio = (double)pageFaults / numAccesses;
-  double successRatio = (double)(numAccesses - pageFaults) / numAccesses;
-  Stats s;
-  s.pageFrames = numFrames;
-  s.failRatio = failRatio;
-  s.successRatio = successRatio;
-  s.numAccesses = numAccesses;
-  s.pageFaults = pageFaults;
-  s.pageHits = pageHits;
+// Service mode wire format (see BATCH_USAGE), in host order, which the
+// protocol fixes as little-endian
+struct ServiceRequest {
+  uint32_t id;
+  uint32_t policy; // ReplacementPolicy
+  uint32_t frames;
+  uint32_t seed;
+};
 
-  return s;
+enum ServiceStatus : uint32_t {
+  SERVICE_OK,
+  SERVICE_BAD_REQUEST,
+  SERVICE_FAILED
+};
+
+struct ServiceResponse {
+  uint32_t id;
+  uint32_t status;
+  uint32_t faults;
+  uint32_t hits;
+  double failRatio;
+};
+
+static_assert(sizeof(ServiceRequest) == 16 && sizeof(ServiceResponse) == 24,
+              "Service records must match the documented protocol");
+
+// Larger frame counts are refused rather than letting one query allocate
+// without bound
+const uint32_t SERVICE_MAX_FRAMES = 1 << 22;
+
+// Bytes of responses, sent or still owed, a client may have queued before
+// its further requests wait for it to read some
+const size_t SERVICE_MAX_BACKLOG = 1 << 20;
+
+#ifdef __linux__
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "Service records are sent in host order");
+
+// State shared by the event loop and the simulation workers
+struct SimulationService {
+  int pageSize{};
+  int agingBits{DEFAULT_AGING_BITS};
+  vector<Job> jobs;
+  map<unsigned, vector<Access>> traces; // By seed
+
+  mutex lock; // Guards the members below
+  map<uint64_t, ServiceResponse> cache; // By serviceKey; id unused
+  // Connection and request id of everyone waiting on a running query
+  map<uint64_t, vector<pair<uint64_t, uint32_t>>> inFlight;
+  // Finished responses for the event loop to send, by connection
+  vector<pair<uint64_t, ServiceResponse>> completed;
+  int wakeFd{-1}; // eventfd the workers signal once completed has entries
+  uint64_t cacheHits{};
+  uint64_t simulations{};
+};
+
+// A client; in holds a partial request and out unsent responses
+struct ServiceConnection {
+  int fd{-1};
+  string in, out;
+  int pending{};     // Requests waiting on a simulation
+  bool eof{};        // Client has stopped sending
+  uint32_t events{}; // What epoll watches for
+};
+
+// Queued and owed response bytes
+size_t connectionBacklog(const ServiceConnection &conn) {
+  return conn.out.size() + conn.pending * sizeof(ServiceResponse);
 }
 
-int main() {
-  try {
-    printf("Demand Paged Memory Allocation\n");
+const uint64_t SERVICE_LISTEN_ID = 0;
+const uint64_t SERVICE_SIGNAL_ID = 1;
+const uint64_t SERVICE_WAKE_ID = 2;
 
-    int pageSize, numJobs, numFrames;
+uint64_t serviceKey(const ServiceRequest &r) {
+  return (uint64_t)r.frames << 34 | (uint64_t)r.seed << 2 | r.policy;
+}
 
-    cout << "Enter Page Size: ";
-    cin >> pageSize;
+// Answers r from the cache, or else queues its simulation on the pool, once
+// per distinct query however many clients ask while it runs. Returns true if
+// res holds the answer now.
+bool serviceQuery(SimulationService &svc, WorkStealingPool &pool,
+                  uint64_t conn, const ServiceRequest &r,
+                  ServiceResponse &res) {
+  res = {r.id, SERVICE_BAD_REQUEST, 0, 0, 0};
+  auto trace = svc.traces.find(r.seed);
+  if (r.policy > (uint32_t)ReplacementPolicy::Clock || r.frames == 0 ||
+      r.frames > SERVICE_MAX_FRAMES || trace == svc.traces.end())
+    return true;
+
+  uint64_t key = serviceKey(r);
+  {
+    lock_guard<mutex> lk(svc.lock);
+    auto cached = svc.cache.find(key);
+    if (cached != svc.cache.end()) {
+      svc.cacheHits++;
+      res = cached->second;
+      res.id = r.id;
+      return true;
+    }
+    auto &waiters = svc.inFlight[key];
+    waiters.push_back({conn, r.id});
+    if (waiters.size() > 1)
+      return false;
+    svc.simulations++;
+  }
 
-    cout << "Enter number of jobs: ";
-    cin >> numJobs;
+  const vector<Access> *accesses = &trace->second;
+  auto policy = (ReplacementPolicy)r.policy;
+  int frames = (int)r.frames;
+  pool.submit([&svc, key, accesses, policy, frames] {
+    ServiceResponse res{0, SERVICE_FAILED, 0, 0, 0};
+    try {
+      auto s = simulateDemandPagingTrace(frames, svc.pageSize, svc.jobs,
+                                         *accesses, policy, false, nullptr,
+                                         nullptr, svc.agingBits);
+      res = {0, SERVICE_OK, (uint32_t)s.pageFaults, (uint32_t)s.pageHits,
+             s.failRatio};
+    } catch (const exception &) {
+    }
+    {
+      lock_guard<mutex> lk(svc.lock);
+      if (res.status == SERVICE_OK)
+        svc.cache[key] = res;
+      for (const auto &w : svc.inFlight[key]) {
+        res.id = w.second;
+        svc.completed.push_back({w.first, res});
+      }
+      svc.inFlight.erase(key);
+    }
+    eventfd_write(svc.wakeFd, 1);
+  });
+  return false;
+}
 
-    cout << "Enter number of available memory frames: ";
-    cin >> numFrames;
+// Reads what the client sent and answers each complete request, until its
+// backlog is full; returns false if the connection failed
+bool readConnection(SimulationService &svc, WorkStealingPool &pool,
+                    uint64_t id, ServiceConnection &conn) {
+  char buf[4096];
+  size_t used = 0;
+  for (;;) {
+    for (; conn.in.size() - used >= sizeof(ServiceRequest) &&
+           connectionBacklog(conn) < SERVICE_MAX_BACKLOG;
+         used += sizeof(ServiceRequest)) {
+      ServiceRequest r;
+      memcpy(&r, conn.in.data() + used, sizeof(r));
+      ServiceResponse res;
+      if (serviceQuery(svc, pool, id, r, res))
+        conn.out.append((const char *)&res, sizeof(res));
+      else
+        conn.pending++;
+    }
+    if (conn.eof || connectionBacklog(conn) >= SERVICE_MAX_BACKLOG)
+      break;
+    conn.in.erase(0, used);
+    used = 0;
+    ssize_t n = recv(conn.fd, buf, sizeof(buf), 0);
+    if (n > 0) {
+      conn.in.append(buf, n);
+    } else if (n == 0) {
+      conn.eof = true;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      break;
+    } else if (errno != EINTR) {
+      return false;
+    }
+  }
+  conn.in.erase(0, used);
+  return true;
+}
+
+// Sends what it can of conn's responses; returns false if the connection
+// failed
+bool flushConnection(ServiceConnection &conn) {
+  while (!conn.out.empty()) {
+    ssize_t n =
+        send(conn.fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+    if (n >= 0)
+      conn.out.erase(0, n);
+    else if (errno == EAGAIN || errno == EWOULDBLOCK)
+      break;
+    else if (errno != EINTR)
+      return false;
+  }
+  return true;
+}
+
+// Watches for requests until the client stops sending or its backlog is
+// full, and for writability while responses are queued; returns false once
+// the connection is finished
+bool updateConnection(int epollFd, uint64_t id, ServiceConnection &conn) {
+  if (conn.eof && conn.pending == 0 && conn.out.empty())
+    return false;
+  bool reading = !conn.eof && connectionBacklog(conn) < SERVICE_MAX_BACKLOG;
+  uint32_t events = (reading ? (uint32_t)EPOLLIN : 0) |
+                    (conn.out.empty() ? 0 : (uint32_t)EPOLLOUT);
+  if (events != conn.events) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.u64 = id;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+    conn.events = events;
+  }
+  return true;
+}
 
-    // Generate some random page accesses
-    int numAccesses;
-    cout << "Enter number of page accesses to simulate: ";
-    cin >> numAccesses;
+// Serves queries on c.servePath until SIGINT or SIGTERM. The event loop owns
+// the sockets and the cache lookups; only cache misses reach the workers.
+void runService(const BatchConfig &c) {
+  if (c.pageSize <= 0 || c.numAccesses <= 0) {
+    throw runtime_error("Service mode needs --page-size and --accesses");
+  }
+  SimulationService svc;
+  svc.pageSize = c.pageSize;
+  if (c.agingBits > 0)
+    svc.agingBits = c.agingBits;
+  svc.jobs = batchJobs(c);
+  auto pages = pagesPerJob((int)svc.jobs.size(), c.pageSize, svc.jobs);
+  for (unsigned seed : c.seeds)
+    svc.traces[seed] = generateTrace(pages, c.numAccesses, seed);
+
+  sockaddr_un addr{};
+  if (c.servePath.size() >= sizeof(addr.sun_path)) {
+    throw runtime_error("Socket path is too long: " + c.servePath);
+  }
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, c.servePath.c_str());
+  struct stat st;
+  if (stat(c.servePath.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+    unlink(c.servePath.c_str()); // Left behind by an earlier run
+  int listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenFd < 0 || bind(listenFd, (sockaddr *)&addr, sizeof(addr)) < 0 ||
+      listen(listenFd, SOMAXCONN) < 0) {
+    throw runtime_error("Cannot listen on " + c.servePath + ": " +
+                        strerror(errno));
+  }
+
+  // Stop signals arrive through a signalfd, so block them before the
+  // workers start and inherit the mask
+  sigset_t stopSignals;
+  sigemptyset(&stopSignals);
+  sigaddset(&stopSignals, SIGINT);
+  sigaddset(&stopSignals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+  int signalFd = signalfd(-1, &stopSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+  svc.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  int epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (signalFd < 0 || svc.wakeFd < 0 || epollFd < 0) {
+    throw runtime_error(string("Cannot set up the event loop: ") +
+                        strerror(errno));
+  }
+  for (auto fdId : {make_pair(listenFd, SERVICE_LISTEN_ID),
+                    make_pair(signalFd, SERVICE_SIGNAL_ID),
+                    make_pair(svc.wakeFd, SERVICE_WAKE_ID)}) {
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = fdId.second;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fdId.first, &ev);
+  }
 
-    if (pageSize <= 0 || numJobs <= 0 || numFrames <= 0 || numAccesses <= 0) {
-      throw runtime_error("All inputs must be positive integers!");
+  int numWorkers = c.numWorkers > 0
+                       ? c.numWorkers
+                       : (int)max(1u, thread::hardware_concurrency());
+  printf("Serving %zu jobs and %zu traces of %lld accesses on %s with %d "
+         "worker%s\n",
+         svc.jobs.size(), svc.traces.size(), (long long)c.numAccesses,
+         c.servePath.c_str(), numWorkers, numWorkers == 1 ? "" : "s");
+  fflush(stdout);
+
+  map<uint64_t, ServiceConnection> conns;
+  uint64_t nextConn = SERVICE_WAKE_ID + 1;
+  auto closeConnection = [&](uint64_t id) {
+    close(conns[id].fd);
+    conns.erase(id);
+  };
+  // Flushing first makes room for requests held back by a full backlog
+  auto serveConnection = [&](WorkStealingPool &pool, uint64_t id) {
+    auto &conn = conns[id];
+    if (!flushConnection(conn) || !readConnection(svc, pool, id, conn) ||
+        !flushConnection(conn) || !updateConnection(epollFd, id, conn))
+      closeConnection(id);
+  };
+  {
+    // Declared after everything its tasks touch; its destructor lets
+    // running simulations finish
+    WorkStealingPool pool(numWorkers);
+    const int maxEvents = 64;
+    epoll_event events[maxEvents];
+    for (bool running = true; running;) {
+      int n = epoll_wait(epollFd, events, maxEvents, -1);
+      if (n < 0 && errno != EINTR) {
+        throw runtime_error(string("epoll_wait failed: ") + strerror(errno));
+      }
+      for (int i = 0; i < n; i++) {
+        uint64_t id = events[i].data.u64;
+        if (id == SERVICE_SIGNAL_ID) {
+          signalfd_siginfo info; // Consumed so it is not raised on unblock
+          if (read(signalFd, &info, sizeof(info)) == sizeof(info))
+            running = false;
+        } else if (id == SERVICE_LISTEN_ID) {
+          int fd;
+          while ((fd = accept4(listenFd, nullptr, nullptr,
+                               SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+            auto &conn = conns[nextConn];
+            conn.fd = fd;
+            conn.events = EPOLLIN;
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.u64 = nextConn++;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+          }
+        } else if (id == SERVICE_WAKE_ID) {
+          eventfd_t ignored;
+          eventfd_read(svc.wakeFd, &ignored);
+          vector<pair<uint64_t, ServiceResponse>> done;
+          {
+            lock_guard<mutex> lk(svc.lock);
+            done.swap(svc.completed);
+          }
+          for (const auto &d : done) {
+            auto it = conns.find(d.first);
+            if (it == conns.end())
+              continue; // Client went away
+            it->second.pending--;
+            it->second.out.append((const char *)&d.second,
+                                  sizeof(d.second));
+          }
+          for (const auto &d : done)
+            if (conns.count(d.first))
+              serveConnection(pool, d.first);
+        } else {
+          if (!conns.count(id))
+            continue;
+          // A hung-up client cannot read its answers, and epoll would keep
+          // reporting the hangup whatever it watches
+          if (events[i].events & (EPOLLHUP | EPOLLERR))
+            closeConnection(id);
+          else
+            serveConnection(pool, id);
+        }
+      }
     }
+  }
 
-    // Accept jobs
-    vector<Job> jobs;
-    for (int i = 0; i < numJobs; i++) {
-      Job j;
-      j.id = i;
-      cout << "Enter size of Job " << j.id << " : ";
-      cin >> j.size;
-      if (j.size <= 0) {
-        throw runtime_error("Job size must be a positive integer!");
+  for (auto &kv : conns)
+    close(kv.second.fd);
+  close(epollFd);
+  close(signalFd);
+  close(svc.wakeFd);
+  close(listenFd);
+  unlink(c.servePath.c_str());
+  pthread_sigmask(SIG_UNBLOCK, &stopSignals, nullptr);
+  printf("Answered %llu queries from the cache and ran %llu simulations\n",
+         (unsigned long long)svc.cacheHits,
+         (unsigned long long)svc.simulations);
+  if (memReportEnabled)
+    printMemoryPeaks(stdout);
+}
+#else
+void runService(const BatchConfig &) {
+  throw runtime_error("Service mode needs Linux");
+}
+#endif
+
+// Runs every policy at every frame count on every seed's trace and writes
+// one result per run in the configured format
+void runBatch(const BatchConfig &c) {
+  // The report goes in with the results, which only text has room for
+  if (memReportEnabled && c.format != "text") {
+    throw runtime_error("--mem-report needs --format text");
+  }
+  if (!c.servePath.empty()) {
+    runService(c);
+    return;
+  }
+  if (c.checkpointEvery > 0 && c.checkpointPath.empty()) {
+    throw runtime_error("--checkpoint-every needs --checkpoint");
+  }
+  if (!c.checkpointPath.empty() || !c.resumePath.empty()) {
+    runCheckpointed(c);
+    return;
+  }
+  if (c.pageSize <= 0 || c.frameCounts.empty() || c.numAccesses <= 0) {
+    throw runtime_error("Batch runs need --page-size, --frames and --accesses");
+  }
+  auto jobs = batchJobs(c);
+  int numJobs = (int)jobs.size();
+
+  // The memory report wants each run's tables built afresh; otherwise one
+  // context serves every point
+  unique_ptr<SimulationContext> ctx;
+  if (!memReportEnabled)
+    ctx.reset(new SimulationContext(
+        *max_element(c.frameCounts.begin(), c.frameCounts.end()), c.pageSize,
+        jobs));
+  int agingBits = c.agingBits > 0 ? c.agingBits : DEFAULT_AGING_BITS;
+  if (ctx)
+    ctx->setAgingBits(agingBits);
+
+  FILE *out = openBatchOutput(c);
+  bool first = true;
+  for (unsigned seed : c.seeds) {
+    auto trace = generateTrace(pagesPerJob(numJobs, c.pageSize, jobs),
+                               c.numAccesses, seed);
+    for (int frames : c.frameCounts) {
+      for (auto policy : c.policies) {
+        auto s = ctx ? simulateSweepPoint(*ctx, frames, policy, trace)
+                     : simulateDemandPagingTrace(frames, c.pageSize, jobs,
+                                                 trace, policy, false,
+                                                 nullptr, nullptr, agingBits);
+        printBatchResult(out, c, first, policy, seed, numJobs, s);
+        first = false;
       }
-      jobs.push_back(j);
-    }
-
-    printf("\n--- Jobs Summary ---\n");
-    for (const auto &job : jobs) {
-      printf("Job %d: %d K\n", job.id, job.size);
-    }
-
-    printf("\n--- FIFO Page Replacement ---\n");
-    auto fifoStats = simulateDemandPaging(numJobs, numFrames, pageSize,
-                                          numAccesses, jobs, true);
-    printf("Total Accesses: %d\n", fifoStats.numAccesses);
-    printf("Page Faults: %d\n", fifoStats.pageFaults);
-    printf("Page Hits: %d\n", fifoStats.pageHits);
-    printf("Failure Ratio: %.2f\n", fifoStats.failRatio);
-    printf("Success Ratio: %.2f\n", fifoStats.successRatio);
-
-    printf("\n--- LRU Page Replacement ---\n");
-    auto lruStats = simulateDemandPaging(numJobs, numFrames, pageSize,
-                                         numAccesses, jobs, false);
-    printf("Total Accesses: %d\n", lruStats.numAccesses);
-    printf("Page Faults: %d\n", lruStats.pageFaults);
-    printf("Page Hits: %d\n", lruStats.pageHits);
-    printf("Failure Ratio: %.2f\n", lruStats.failRatio);
-    printf("Success Ratio: %.2f\n", lruStats.successRatio);
+    }
+  }
+  closeBatchOutput(c, out);
+}
+
+// Prompts for the jobs and a simulation mode, then runs it
+void runInteractive() {
+  printf("Demand Paged Memory Allocation\n");
+
+  int pageSize, numJobs, numFrames;
+
+  cout << "Enter Page Size: ";
+  cin >> pageSize;
+
+  cout << "Enter number of jobs: ";
+  cin >> numJobs;
+
+  cout << "Enter number of available memory frames: ";
+  cin >> numFrames;
+
+  // Generate some random page accesses
+  int numAccesses;
+  cout << "Enter number of page accesses to simulate: ";
+  cin >> numAccesses;
+
+  if (pageSize <= 0 || numJobs <= 0 || numFrames <= 0 || numAccesses <= 0) {
+    throw runtime_error("All inputs must be positive integers!");
+  }
+
+  // Accept jobs
+  vector<Job> jobs;
+  for (int i = 0; i < numJobs; i++) {
+    Job j;
+    j.id = i;
+    cout << "Enter size of Job " << j.id << " : ";
+    cin >> j.size;
+    if (j.size <= 0) {
+      throw runtime_error("Job size must be a positive integer!");
+    }
+    jobs.push_back(j);
+  }
+
+  printf("\n--- Jobs Summary ---\n");
+  for (const auto &job : jobs) {
+    printf("Job %d: %d K\n", job.id, job.size);
+  }
+
+  printf("\n--- Simulation Modes ---\n");
+  printf("1) FIFO vs LRU comparison\n");
+  printf("2) Concurrent CPUs sharing the frame table\n");
+  printf("3) Concurrent hit-path scaling (CLOCK vs LRU)\n");
+  printf("4) Job-sharded local replacement\n");
+  printf("5) Frame-count sweep on a work-stealing pool\n");
+  printf("6) One-pass policy fan-out on a shared trace\n");
+  printf("7) Generate a trace file\n");
+  printf("8) Replay a trace file (pipelined decode)\n");
+  printf("9) NUMA memory model\n");
+  printf("10) Coroutine jobs blocking on faults\n");
+  printf("11) Fault-rate timeline\n");
+  printf("12) Aging counter widths (LRU)\n");
+  int mode;
+  cout << "Select mode: ";
+  cin >> mode;
+
+  if (mode == 2 || mode == 3) {
+    int maxThreads;
+    cout << "Enter max number of CPU threads: ";
+    cin >> maxThreads;
+    if (maxThreads <= 0) {
+      throw runtime_error("Thread count must be a positive integer!");
+    }
+    if (mode == 2)
+      printConcurrentScaling(numJobs, numFrames, pageSize, numAccesses, jobs,
+                             maxThreads);
+    else
+      printConcurrentHitScaling(numJobs, pageSize, jobs, numAccesses,
+                                maxThreads);
+    return;
+  }
+  if (mode == 4) {
+    int maxShards;
+    cout << "Enter max number of shards: ";
+    cin >> maxShards;
+    if (maxShards <= 0) {
+      throw runtime_error("Shard count must be a positive integer!");
+    }
+    printShardedScaling(numJobs, numFrames, pageSize, numAccesses, jobs,
+                        maxShards);
+    return;
+  }
+  if (mode == 5) {
+    int numWorkers;
+    cout << "Enter number of worker threads: ";
+    cin >> numWorkers;
+    if (numWorkers <= 0) {
+      throw runtime_error("Worker count must be a positive integer!");
+    }
+    printFrameSweep(numJobs, numFrames, pageSize, numAccesses, jobs,
+                    numWorkers);
+    return;
+  }
+  if (mode == 6) {
+    printFanOutComparison(numJobs, numFrames, pageSize, numAccesses, jobs);
+    return;
+  }
+  if (mode == 7 || mode == 8) {
+    string path;
+    cout << "Enter trace file path: ";
+    cin >> path;
+    if (mode == 7) {
+      random_device rnd;
+      writeTraceFile(path, generateTrace(pagesPerJob(numJobs, pageSize, jobs),
+                                         numAccesses, rnd()));
+      printf("Wrote %d accesses to %s\n", numAccesses, path.c_str());
+    } else {
+      printTraceReplay(path, numJobs, numFrames, pageSize, jobs);
+    }
+    return;
+  }
+  if (mode == 9) {
+    int numNodes;
+    double remoteCost;
+    cout << "Enter number of NUMA nodes: ";
+    cin >> numNodes;
+    cout << "Enter remote access cost (e.g. 1.5 for 1.5x local): ";
+    cin >> remoteCost;
+    printNumaComparison(numJobs, numFrames, pageSize, numAccesses, jobs,
+                        numNodes, remoteCost);
+    return;
+  }
+  if (mode == 10) {
+    int faultLatency, quantum;
+    cout << "Enter page fault I/O latency (in access ticks): ";
+    cin >> faultLatency;
+    cout << "Enter scheduling quantum (accesses): ";
+    cin >> quantum;
+    printCoroutineComparison(numJobs, numFrames, pageSize, numAccesses, jobs,
+                             faultLatency, quantum);
+    return;
+  }
+  if (mode == 12) {
+    printAgingWidths(numJobs, numFrames, pageSize, numAccesses, jobs);
+    return;
+  }
+  if (mode == 11) {
+    int policy, windowSize;
+    string path;
+    cout << "Enter replacement policy (0 FIFO, 1 LRU, 2 CLOCK): ";
+    cin >> policy;
+    if (policy < 0 || policy > 2) {
+      throw runtime_error("Unknown replacement policy!");
+    }
+    cout << "Enter window size (accesses): ";
+    cin >> windowSize;
+    cout << "Enter output path (.bin for binary, else CSV): ";
+    cin >> path;
+
+    FaultTimeline timeline;
+    initTimeline(timeline, windowSize);
+    random_device rnd;
+    auto trace = generateTrace(pagesPerJob(numJobs, pageSize, jobs),
+                               numAccesses, rnd());
+    auto stats = simulateDemandPagingTrace(numFrames, pageSize, jobs, trace,
+                                           (ReplacementPolicy)policy, false,
+                                           &timeline);
+    bool binary = path.size() >= 4 && path.substr(path.size() - 4) == ".bin";
+    writeTimeline(path, timeline, binary);
+    printf("Wrote %zu windows of %d accesses to %s (failure ratio %.2f)\n",
+           timelineWindows(timeline).size(), windowSize, path.c_str(),
+           stats.failRatio);
+    return;
+  }
+  if (mode != 1) {
+    throw runtime_error("Unknown simulation mode!");
+  }
+
+  // Both policies replay the same accesses
+  random_device rnd;
+  auto trace = generateTrace(pagesPerJob(numJobs, pageSize, jobs),
+                             numAccesses, rnd());
+
+  PerfCounters counters;
+  printf("\n--- FIFO Page Replacement ---\n");
+  auto fifoStats =
+      simulateDemandPagingTrace(numFrames, pageSize, jobs, trace,
+                                ReplacementPolicy::Fifo, true, nullptr,
+                                &counters);
+  printf("Total Accesses: %lld\n", (long long)fifoStats.numAccesses);
+  printf("Page Faults: %lld\n", (long long)fifoStats.pageFaults);
+  printf("Page Hits: %lld\n", (long long)fifoStats.pageHits);
+  printf("Failure Ratio: %.2f\n", fifoStats.failRatio);
+  printf("Success Ratio: %.2f\n", fifoStats.successRatio);
+  printPerformance(fifoStats);
+  printAttribution(fifoStats.attribution, ATTRIBUTION_TOP_N);
+  if (memReportEnabled)
+    printMemoryReport(stdout, fifoStats);
+
+  printf("\n--- LRU Page Replacement ---\n");
+  auto lruStats =
+      simulateDemandPagingTrace(numFrames, pageSize, jobs, trace,
+                                ReplacementPolicy::Lru, true, nullptr,
+                                &counters);
+  printf("Total Accesses: %lld\n", (long long)lruStats.numAccesses);
+  printf("Page Faults: %lld\n", (long long)lruStats.pageFaults);
+  printf("Page Hits: %lld\n", (long long)lruStats.pageHits);
+  printf("Failure Ratio: %.2f\n", lruStats.failRatio);
+  printf("Success Ratio: %.2f\n", lruStats.successRatio);
+  printPerformance(lruStats);
+  printAttribution(lruStats.attribution, ATTRIBUTION_TOP_N);
+  if (memReportEnabled)
+    printMemoryReport(stdout, lruStats);
+}
+
+int main(int argc, char **argv) {
+  if (argc == 2 && string(argv[1]) == "--help") {
+    printf(BATCH_USAGE, argv[0]);
+    return 0;
+  }
+  BatchConfig batch;
+  bool unattended;
+  try {
+    unattended = parseBatchArgs(argc, argv, batch);
+  } catch (const exception &e) {
+    printf("Error: %s\n", e.what());
+    printf(BATCH_USAGE, argv[0]);
+    return 1;
+  }
+
+  try {
+    if (unattended) {
+      runBatch(batch);
+      return 0;
+    }
+    runInteractive();
+    if (memReportEnabled)
+      printMemoryPeaks(stdout);
   } catch (const exception &e) {
     printf("Error: %s\n", e.what());
     return 1;
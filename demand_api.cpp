@@ -0,0 +1,117 @@
+// Description: C interface to the demand paging simulator (see demand_api.h).
+// Exceptions stop here and become status codes.
+//
+// Compile: g++ demand_api.cpp engine.cpp paging.cpp -std=c++20 -pthread -O2
+//          -fPIC -fvisibility=hidden -shared -o libdemand.so
+
+#include "demand_api.h"
+
+#include <cstddef>
+#include <new>
+#include <string>
+
+#include "engine.h"
+
+using namespace std;
+
+// The accesses handed to paging_sim_feed are read as Access without a copy
+static_assert(sizeof(paging_access) == sizeof(Access) &&
+                  offsetof(paging_access, job_id) == offsetof(Access, jobId) &&
+                  offsetof(paging_access, page_number) ==
+                      offsetof(Access, pageNumber),
+              "paging_access must have the layout of Access");
+
+struct paging_sim {
+  paging_sim(int numFrames, int pageSize, ReplacementPolicy policy)
+      : stream(numFrames, pageSize, policy) {}
+
+  DemandPagingStream stream;
+  string lastError;
+};
+
+bool validPolicy(int policy) {
+  return policy >= PAGING_FIFO && policy <= PAGING_CLOCK;
+}
+
+// Runs op on sim, turning what it throws into a status
+template <class F> int guarded(paging_sim *sim, F op) {
+  try {
+    op();
+    return PAGING_OK;
+  } catch (const bad_alloc &) {
+    sim->lastError = "Out of memory";
+    return PAGING_FAILED;
+  } catch (const exception &e) {
+    sim->lastError = e.what();
+    return PAGING_INVALID;
+  }
+}
+
+extern "C" {
+
+paging_sim *paging_sim_create(int num_frames, int page_size, int policy) {
+  if (!validPolicy(policy))
+    return nullptr;
+  try {
+    return new paging_sim(num_frames, page_size, (ReplacementPolicy)policy);
+  } catch (const exception &) {
+    return nullptr;
+  }
+}
+
+void paging_sim_destroy(paging_sim *sim) { delete sim; }
+
+int paging_sim_add_job(paging_sim *sim, int job_id, int size) {
+  if (!sim)
+    return PAGING_INVALID;
+  return guarded(sim, [&] { sim->stream.addJob({job_id, size}); });
+}
+
+int paging_sim_remove_job(paging_sim *sim, int job_id) {
+  if (!sim)
+    return PAGING_INVALID;
+  return guarded(sim, [&] { sim->stream.removeJob(job_id); });
+}
+
+int paging_sim_feed(paging_sim *sim, const paging_access *accesses,
+                    size_t count) {
+  if (!sim || (!accesses && count > 0))
+    return PAGING_INVALID;
+  return guarded(sim, [&] {
+    sim->stream.feed(reinterpret_cast<const Access *>(accesses), count);
+  });
+}
+
+int paging_sim_set_policy(paging_sim *sim, int policy) {
+  if (!sim)
+    return PAGING_INVALID;
+  if (!validPolicy(policy)) {
+    sim->lastError = "Unknown replacement policy " + to_string(policy);
+    return PAGING_INVALID;
+  }
+  sim->stream.setPolicy((ReplacementPolicy)policy);
+  return PAGING_OK;
+}
+
+// Read straight from the engine, which has counters Stats lacks
+int paging_sim_get_stats(const paging_sim *sim, paging_stats *out) {
+  if (!sim || !out)
+    return PAGING_INVALID;
+  const auto &e = sim->stream.engine();
+  out->accesses = e.numAccesses;
+  out->faults = e.pageFaults;
+  out->hits = e.pageHits;
+  out->evictions = e.evictions;
+  out->fail_ratio =
+      e.numAccesses > 0 ? (double)e.pageFaults / e.numAccesses : 0;
+  out->frames = e.numFrames;
+  out->resident_pages = (int32_t)e.residentPages;
+  out->jobs = (int32_t)e.JT.size();
+  return PAGING_OK;
+}
+
+const char *paging_sim_last_error(const paging_sim *sim) {
+  return sim ? sim->lastError.c_str() : "No simulator";
+}
+
+} // extern "C"
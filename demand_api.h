@@ -0,0 +1,85 @@
+// Description: C interface to the demand paging simulator for callers that
+// load it through an FFI. A simulator is fed batches of accesses and can be
+// queried between them; it wraps DemandPagingStream from engine.h.
+//
+// Functions returning int give PAGING_OK or a negative paging_status, and
+// paging_sim_last_error describes the last failure. A simulator must not be
+// used by two threads at once.
+//
+// Build: make libdemand.so
+
+#ifndef DEMAND_API_H
+#define DEMAND_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define PAGING_API __attribute__((visibility("default")))
+#else
+#define PAGING_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct paging_sim paging_sim;
+
+enum paging_policy { PAGING_FIFO = 0, PAGING_LRU = 1, PAGING_CLOCK = 2 };
+
+enum paging_status {
+  PAGING_OK = 0,
+  PAGING_INVALID = -1, // Bad argument, or an unknown job or page
+  PAGING_FAILED = -2   // Anything else, e.g. out of memory
+};
+
+// One access; arrays of these are read in place by paging_sim_feed
+typedef struct paging_access {
+  int32_t job_id;
+  int32_t page_number;
+} paging_access;
+
+// Counters since the simulator was created
+typedef struct paging_stats {
+  int64_t accesses;
+  int64_t faults;
+  int64_t hits;
+  int64_t evictions;
+  double fail_ratio; // faults / accesses, 0 before any access
+  int32_t frames;
+  int32_t resident_pages;
+  int32_t jobs;
+} paging_stats;
+
+// A simulator with num_frames empty frames, or NULL if the arguments are
+// invalid or memory runs out
+PAGING_API paging_sim *paging_sim_create(int num_frames, int page_size,
+                                         int policy);
+PAGING_API void paging_sim_destroy(paging_sim *sim);
+
+// Registers a job of size bytes; its pages start out of memory
+PAGING_API int paging_sim_add_job(paging_sim *sim, int job_id, int size);
+
+// Unregisters a job, freeing the frames it held
+PAGING_API int paging_sim_remove_job(paging_sim *sim, int job_id);
+
+// Services count accesses in order, reading them where they are. An access
+// to an unknown job or page returns PAGING_INVALID, with the accesses before
+// it serviced.
+PAGING_API int paging_sim_feed(paging_sim *sim, const paging_access *accesses,
+                               size_t count);
+
+// Replacement policy for the accesses fed from now on
+PAGING_API int paging_sim_set_policy(paging_sim *sim, int policy);
+
+PAGING_API int paging_sim_get_stats(const paging_sim *sim, paging_stats *out);
+
+// What the last failing call on sim went wrong with, or ""
+PAGING_API const char *paging_sim_last_error(const paging_sim *sim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1300 @@
+// Description: Demand paging engine shared by the simulator, the benchmarks
+// and the C interface (see engine.h)
+
+#include "engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <sys/resource.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+
+Access nextAccess(TraceGenerator &tg) {
+  uniform_int_distribution<> jobDist(0, (int)tg.pagesPerJob.size() - 1);
+  Access a;
+  do {
+    a.jobId = jobDist(tg.gen);
+  } while (tg.pagesPerJob[a.jobId] == 0);
+  uniform_int_distribution<> pageDist(0, tg.pagesPerJob[a.jobId] - 1);
+  a.pageNumber = pageDist(tg.gen);
+  tg.remaining--;
+  return a;
+}
+
+int fillBlock(TraceGenerator &tg, AccessBlock &block) {
+  block.count = 0;
+  while (block.count < ACCESS_BLOCK_SIZE && tg.remaining > 0)
+    block.accesses[block.count++] = nextAccess(tg);
+  return block.count;
+}
+
+vector<Access> generateTrace(const vector<int> &pagesPerJob,
+                             int64_t numAccesses, unsigned seed) {
+  TraceGenerator tg(pagesPerJob, numAccesses, seed);
+  vector<Access> trace;
+  trace.reserve(numAccesses);
+  while (tg.remaining > 0)
+    trace.push_back(nextAccess(tg));
+  return trace;
+}
+
+vector<int> pagesPerJob(int numJobs, int pageSize, const vector<Job> &jobs) {
+  vector<int> res(numJobs);
+  for (const auto &job : jobs)
+    res[job.id] = (int)divideIntoPages(job, pageSize).first.size();
+  return res;
+}
+
+// Cheap timestamp: the TSC where there is one, steady_clock otherwise
+inline uint64_t readTimestamp() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// Timestamp ticks per second, calibrated against steady_clock on first use
+double timestampTicksPerSecond() {
+  static double rate = [] {
+    auto start = chrono::steady_clock::now();
+    uint64_t ticks = readTimestamp();
+    this_thread::sleep_for(chrono::milliseconds(20));
+    ticks = readTimestamp() - ticks;
+    return ticks / chrono::duration<double>(chrono::steady_clock::now() - start)
+                       .count();
+  }();
+  return rate;
+}
+
+// Adds the timestamp ticks spent in its scope to a phase counter
+struct ScopedPhaseTimer {
+  uint64_t &total;
+  uint64_t start;
+
+  explicit ScopedPhaseTimer(uint64_t &total)
+      : total(total), start(readTimestamp()) {}
+  ~ScopedPhaseTimer() { total += readTimestamp() - start; }
+};
+
+// Times the rest of the enclosing scope into counters[phase]. Compiled out
+// unless built with -DPAGING_PHASE_TIMERS.
+#ifdef PAGING_PHASE_TIMERS
+#define PHASE_TIMER_NAME2(line) phaseTimer##line
+#define PHASE_TIMER_NAME(line) PHASE_TIMER_NAME2(line)
+#define PHASE_TIMER(counters, phase)                                           \
+  ScopedPhaseTimer PHASE_TIMER_NAME(__LINE__)((counters)[phase])
+#else
+#define PHASE_TIMER(counters, phase)
+#endif
+
+// Peak resident set size of the process in KB
+long peakResidentKb() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+bool perfCountersEnabled = getenv("PAGING_PERF") != nullptr;
+
+const char *const PERF_EVENT_NAMES[NUM_PERF_EVENTS] = {
+    "Cycles", "Instructions", "LLC Misses", "dTLB Misses", "Branch Misses"};
+
+PerfCounters::PerfCounters() {
+#ifdef __linux__
+  if (!perfCountersEnabled)
+    return;
+  const pair<uint32_t, uint64_t> events[NUM_PERF_EVENTS] = {
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+                               (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                               (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+      {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                               (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                               (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}};
+  for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = events[i].first;
+    attr.config = events[i].second;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (int fd : fds)
+    if (fd >= 0)
+      close(fd);
+#endif
+}
+
+void PerfCounters::start() {
+#ifdef __linux__
+  for (int fd : fds)
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+PerfSample PerfCounters::stop() {
+  PerfSample sample;
+#ifdef __linux__
+  for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+    if (fds[i] < 0)
+      continue;
+    ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    uint64_t data[3]; // value, time enabled, time running
+    if (read(fds[i], data, sizeof(data)) != sizeof(data) || data[2] == 0)
+      continue;
+    sample.values[i] = data[2] < data[1]
+                           ? (uint64_t)((double)data[0] * data[1] / data[2])
+                           : data[0];
+    sample.valid[i] = true;
+  }
+#endif
+  return sample;
+}
+
+void initAttribution(AttributionCounters &a, int numJobIds, int numFrames) {
+  a.jobFaults.assign(numJobIds, 0);
+  a.jobHits.assign(numJobIds, 0);
+  a.jobEvictionsCaused.assign(numJobIds, 0);
+  a.jobEvictionsSuffered.assign(numJobIds, 0);
+  a.frameLoads.assign(numFrames, 0);
+  a.frameEvictions.assign(numFrames, 0);
+}
+
+void snapshotMemBytes(int64_t bytes[NUM_MEM_TAGS]) {
+  for (int i = 0; i < NUM_MEM_TAGS; i++)
+    bytes[i] = memCounters[i].bytes.load(memory_order_relaxed);
+}
+
+void initTimeline(FaultTimeline &t, int windowSize, size_t capacity) {
+  if (windowSize <= 0 || capacity == 0) {
+    throw runtime_error("Timeline window size must be a positive integer!");
+  }
+  t = FaultTimeline();
+  t.windowSize = windowSize;
+  t.left = windowSize;
+  t.ring.resize(capacity);
+}
+
+vector<WindowSample> timelineWindows(const FaultTimeline &t) {
+  size_t n = min<uint64_t>(t.closed, t.ring.size());
+  vector<WindowSample> res;
+  res.reserve(n);
+  for (uint64_t w = t.closed - n; w < t.closed; w++)
+    res.push_back(t.ring[w % t.ring.size()]);
+  return res;
+}
+
+void writeTimeline(const string &path, const FaultTimeline &t, bool binary) {
+  FILE *f = fopen(path.c_str(), binary ? "wb" : "w");
+  if (!f) {
+    throw runtime_error("Cannot open timeline file " + path);
+  }
+  auto windows = timelineWindows(t);
+  uint64_t first = t.closed - windows.size();
+  bool ok;
+  if (binary) {
+    uint32_t windowSize = t.windowSize;
+    uint64_t count = windows.size();
+    ok = fwrite("PGTL", 1, 4, f) == 4 &&
+         fwrite(&windowSize, sizeof(windowSize), 1, f) == 1 &&
+         fwrite(&first, sizeof(first), 1, f) == 1 &&
+         fwrite(&count, sizeof(count), 1, f) == 1 &&
+         fwrite(windows.data(), sizeof(WindowSample), count, f) == count;
+  } else {
+    ok = fprintf(f, "window,start_access,accesses,faults,hits,evictions,"
+                    "resident_pages\n") > 0;
+    for (size_t i = 0; i < windows.size() && ok; i++) {
+      const auto &w = windows[i];
+      ok = fprintf(f, "%llu,%llu,%u,%u,%u,%u,%u\n",
+                   (unsigned long long)(first + i),
+                   (unsigned long long)(first + i) * t.windowSize, w.accesses,
+                   w.faults, w.hits, w.evictions, w.residentPages) > 0;
+    }
+  }
+  if (fclose(f) != 0 || !ok) {
+    throw runtime_error("Cannot write timeline file " + path);
+  }
+}
+
+// Modeled latency of a local memory access; remote accesses cost
+// numaRemoteCost times as much
+const double NUMA_LOCAL_LATENCY_NS = 100;
+
+// Remote hits after which NUMA balancing tries to move a page home
+const int NUMA_BALANCE_THRESHOLD = 4;
+
+void initEngine(DemandPagingEngine &e, int numFrames, int pageSize,
+                const vector<Job> &jobs, ReplacementPolicy policy,
+                bool verbose) {
+  e.policy = policy;
+  e.numFrames = numFrames;
+  e.pageSize = pageSize;
+  e.verbose = verbose;
+
+  // Divide all jobs into pages
+  int totalPages = 0;
+  if (verbose)
+    printf("\n--- Dividing Jobs into Pages ---\n");
+  for (const auto &job : jobs) {
+    auto divRes = divideIntoPages(job, pageSize);
+    auto &pages = divRes.first;
+    e.JT[job.id].id = job.id;
+    e.JT[job.id].size = job.size;
+    e.JT[job.id].PMT = move(divRes.second);
+    totalPages += (int)pages.size();
+    if (!verbose)
+      continue;
+
+    printf("\nJob %d divided into %zu pages:\n", job.id, pages.size());
+    for (const auto &page : pages) {
+      printf(" Page %d: %d K\n", page.id, page.size);
+    }
+
+    int internalFrag = pageSize - pages.back().size;
+    if (internalFrag > 0) {
+      printf(" Internal Fragmentation in last page: %d K\n", internalFrag);
+    }
+  }
+
+  int numJobIds = 0;
+  for (const auto &job : jobs)
+    numJobIds = max(numJobIds, job.id + 1);
+  initAttribution(e.attribution, numJobIds, numFrames);
+
+  // Initialize memory
+  e.ram.resize(numFrames);
+  for (int i = 0; i < numFrames; i++) {
+    e.ram[i].id = i;
+    e.ram[i].size = pageSize;
+    e.ram[i].startingAddr = i * pageSize;
+
+    e.MMT[i].pageFrameNumber = i;
+    e.MMT[i].pageNumber = -1;
+    e.MMT[i].jobId = -1;
+    e.MMT[i].busy = false;
+  }
+
+  if (verbose) {
+    printf("\nTotal pages across all jobs: %d\n", totalPages);
+    printf("Available memory frames: %d\n", numFrames);
+    fputs(formatMMT(e.MMT).c_str(), stdout);
+  }
+}
+
+void configureNuma(DemandPagingEngine &e, int numNodes, double remoteCost,
+                   bool balancing) {
+  if (numNodes <= 0 || numNodes > e.numFrames) {
+    throw runtime_error("Every NUMA node needs at least one frame!");
+  }
+  if (remoteCost < 1) {
+    throw runtime_error("Remote memory cannot be cheaper than local memory!");
+  }
+  e.numNodes = numNodes;
+  e.numaRemoteCost = remoteCost;
+  e.numaBalancing = balancing;
+
+  e.nodeFirstFrame.assign(numNodes + 1, e.numFrames);
+  for (int i = e.numFrames - 1; i >= 0; i--) {
+    e.ram[i].node = (int)((long long)i * numNodes / e.numFrames);
+    e.nodeFirstFrame[e.ram[i].node] = i;
+  }
+  e.nodeFifo.assign(numNodes, FrameQueue());
+  e.nodeClockHand.assign(e.nodeFirstFrame.begin(), e.nodeFirstFrame.end() - 1);
+}
+
+void configureAging(DemandPagingEngine &e, int bits) {
+  if (!validAgingBits(bits)) {
+    throw runtime_error("Aging registers must be 8, 16, 32 or 64 bits!");
+  }
+  e.agingBits = bits;
+}
+
+int jobHomeNode(const DemandPagingEngine &e, int jobId) {
+  return jobId % e.numNodes;
+}
+
+// First free frame of a node, or -1
+int findNodeFreeFrame(DemandPagingEngine &e, int node) {
+  for (int i = e.nodeFirstFrame[node]; i < e.nodeFirstFrame[node + 1]; i++)
+    if (!e.MMT[i].busy)
+      return i;
+  return -1;
+}
+
+// Maps a page into a frame and queues the frame on its node. Under every
+// policy a node's queue holds exactly its busy frames in load order, so a
+// resumed run can switch to FIFO.
+void loadNumaFrame(DemandPagingEngine &e, int frameNum, int jobId,
+                   int pageNum) {
+  auto &page = e.JT[jobId].PMT[pageNum];
+  page.pageFrameId = frameNum;
+  page.inMemory = true;
+  page.referenced = AGING_MSB; // Set MSB on reference
+  page.remoteHits = 0;
+
+  e.MMT[frameNum].pageNumber = pageNum;
+  e.MMT[frameNum].jobId = jobId;
+  e.MMT[frameNum].busy = true;
+  e.nodeFifo[e.ram[frameNum].node].push(frameNum);
+  e.attribution.frameLoads[frameNum]++;
+}
+
+// Per-node replacement: picks a victim among one node's frames only with
+// the engine's policy, unmaps it and returns the freed frame
+int evictNodeVictim(DemandPagingEngine &e, int node) {
+  int first = e.nodeFirstFrame[node];
+  int last = e.nodeFirstFrame[node + 1];
+  int victim = -1;
+  switch (e.policy) {
+  case ReplacementPolicy::Fifo:
+    if (!e.nodeFifo[node].empty())
+      victim = e.nodeFifo[node].front();
+    break;
+  case ReplacementPolicy::Lru: {
+    uint64_t smallestRef = UINT64_MAX;
+    for (int i = first; i < last; i++) {
+      const auto &frame = e.MMT[i];
+      uint64_t ref = e.JT[frame.jobId].PMT[frame.pageNumber].referenced;
+      if (frame.busy && ref < smallestRef) {
+        smallestRef = ref;
+        victim = i;
+      }
+    }
+    break;
+  }
+  case ReplacementPolicy::Clock:
+    for (int step = 0; step < 2 * (last - first) && victim == -1; step++) {
+      int frameNum = e.nodeClockHand[node];
+      e.nodeClockHand[node] = frameNum + 1 < last ? frameNum + 1 : first;
+      auto &frame = e.MMT[frameNum];
+      auto &resident = e.JT[frame.jobId].PMT[frame.pageNumber];
+      if (resident.referenced)
+        resident.referenced = 0; // Second chance
+      else
+        victim = frameNum;
+    }
+    break;
+  }
+  if (victim == -1) {
+    throw runtime_error("NUMA: No frame found for replacement on node!");
+  }
+  if (e.policy == ReplacementPolicy::Fifo)
+    e.nodeFifo[node].pop();
+  else
+    e.nodeFifo[node].remove(victim);
+
+  auto &frame = e.MMT[victim];
+  auto &old = e.JT[frame.jobId].PMT[frame.pageNumber];
+  PAGING_PROBE(evict, frame.jobId, frame.pageNumber, -1, -1, victim);
+  e.attribution.jobEvictionsSuffered[frame.jobId]++;
+  e.attribution.frameEvictions[victim]++;
+  old.inMemory = false;
+  old.pageFrameId = -1;
+  old.referenced = 0;
+  if (e.verbose)
+    printf("\tReplacing P%d of J%d (F%d, node %d) (%s)\n", frame.pageNumber,
+           frame.jobId, victim, node, policyName(e.policy));
+  frame.busy = false;
+  frame.jobId = -1;
+  frame.pageNumber = -1;
+  return victim;
+}
+
+// NUMA fault path: local-first allocation falling back to the other nodes,
+// then replacement within the job's home node
+void numaFault(DemandPagingEngine &e, int jobId, int pageNum) {
+  int home = jobHomeNode(e, jobId);
+  int frameNum = -1;
+  for (int i = 0; i < e.numNodes && frameNum == -1; i++)
+    frameNum = findNodeFreeFrame(e, (home + i) % e.numNodes);
+  if (frameNum == -1) {
+    frameNum = evictNodeVictim(e, home);
+    e.evictions++;
+    e.attribution.jobEvictionsCaused[jobId]++;
+  } else {
+    e.residentPages++;
+    PAGING_PROBE(free_frame, jobId, pageNum, frameNum);
+  }
+
+  loadNumaFrame(e, frameNum, jobId, pageNum);
+  if (e.verbose)
+    printf("\tLoaded F%d (node %d, home %d)\n", frameNum,
+           e.ram[frameNum].node, home);
+}
+
+// NUMA balancing: moves a hot remote page to a free frame on its home node,
+// or else swaps it with a page on the home node that is remote there itself,
+// or else with the home node's coldest page
+void migrateToHome(DemandPagingEngine &e, int jobId, int pageNum) {
+  int home = jobHomeNode(e, jobId);
+  auto &page = e.JT[jobId].PMT[pageNum];
+  int from = page.pageFrameId;
+
+  int to = findNodeFreeFrame(e, home);
+  if (to != -1) {
+    e.nodeFifo[e.ram[from].node].remove(from);
+    e.MMT[from].busy = false;
+    e.MMT[from].jobId = -1;
+    e.MMT[from].pageNumber = -1;
+    AgingRegister referenced = page.referenced;
+    loadNumaFrame(e, to, jobId, pageNum);
+    page.referenced = referenced;
+    e.migrations++;
+    return;
+  }
+
+  // The coldest page no hotter than this one; a full 64-bit register leaves
+  // no room to start one above it
+  int coldest = -1;
+  AgingRegister coldestRef = page.referenced;
+  for (int i = e.nodeFirstFrame[home]; i < e.nodeFirstFrame[home + 1]; i++) {
+    const auto &other = e.MMT[i];
+    if (jobHomeNode(e, other.jobId) != home) {
+      to = i;
+      break;
+    }
+    AgingRegister ref = e.JT[other.jobId].PMT[other.pageNumber].referenced;
+    if (ref < coldestRef || (coldest == -1 && ref == coldestRef)) {
+      coldestRef = ref;
+      coldest = i;
+    }
+  }
+  if (to == -1)
+    to = coldest;
+  if (to == -1)
+    return;
+
+  auto &other = e.MMT[to];
+  auto &otherPage = e.JT[other.jobId].PMT[other.pageNumber];
+  otherPage.pageFrameId = from;
+  otherPage.remoteHits = 0;
+  page.pageFrameId = to;
+  swap(e.MMT[from].jobId, other.jobId);
+  swap(e.MMT[from].pageNumber, other.pageNumber);
+  e.attribution.frameLoads[from]++;
+  e.attribution.frameLoads[to]++;
+  e.migrations++;
+}
+
+// Accounts the node an access was served from, balancing hot remote pages
+void recordNumaAccess(DemandPagingEngine &e, int jobId, int pageNum) {
+  auto &page = e.JT[jobId].PMT[pageNum];
+  if (e.ram[page.pageFrameId].node == jobHomeNode(e, jobId)) {
+    e.localAccesses++;
+    return;
+  }
+  e.remoteAccesses++;
+  if (e.numaBalancing && ++page.remoteHits >= NUMA_BALANCE_THRESHOLD) {
+    page.remoteHits = 0;
+    migrateToHome(e, jobId, pageNum);
+  }
+}
+
+// Frames of a queue, front first
+vector<int> queueContents(FrameQueue q) {
+  vector<int> res;
+  for (; !q.empty(); q.pop())
+    res.push_back(q.front());
+  return res;
+}
+
+bool numaQueuesConsistent(const DemandPagingEngine &e) {
+  vector<int> queued(e.numFrames);
+  for (int n = 0; n < (int)e.nodeFifo.size(); n++)
+    for (int f : queueContents(e.nodeFifo[n]))
+      if (f < e.nodeFirstFrame[n] || f >= e.nodeFirstFrame[n + 1] ||
+          !e.MMT.at(f).busy || queued[f]++)
+        return false;
+  for (int f = 0; f < e.numFrames; f++)
+    if (e.MMT.at(f).busy && !queued[f])
+      return false;
+  return true;
+}
+
+// Closes the open timeline window into the ring
+void closeTimelineWindow(DemandPagingEngine &e) {
+  auto &t = *e.timeline;
+  auto &w = t.ring[t.closed++ % t.ring.size()];
+  w.accesses = e.numAccesses - t.startAccesses;
+  w.faults = e.pageFaults - t.startFaults;
+  w.hits = e.pageHits - t.startHits;
+  w.evictions = e.evictions - t.startEvictions;
+  w.residentPages = e.residentPages;
+  t.startAccesses = e.numAccesses;
+  t.startFaults = e.pageFaults;
+  t.startHits = e.pageHits;
+  t.startEvictions = e.evictions;
+  t.left = t.windowSize - 1; // The access that closed it opens the next one
+}
+
+// Closes a partly filled last window once the run is over
+void finishTimeline(DemandPagingEngine &e) {
+  if (e.timeline && e.numAccesses > e.timeline->startAccesses)
+    closeTimelineWindow(e);
+}
+
+void engineAccess(DemandPagingEngine &e, int jobId, int pageNum) {
+  // A window closes when the access after its last one arrives, so the
+  // per-access cost is one countdown
+  if (e.timeline && --e.timeline->left < 0)
+    closeTimelineWindow(e);
+  e.numAccesses++;
+  PAGING_PROBE(access, jobId, pageNum, e.numAccesses);
+  if (e.verbose) {
+    PHASE_TIMER(e.phaseTicks, PHASE_OUTPUT);
+    printf("Access %lld: J%d, P%d : ", (long long)e.numAccesses, jobId,
+           pageNum);
+  }
+
+  auto &PMT = e.JT[jobId].PMT;
+  auto &page = PMT[pageNum];
+
+  // Age all pages' referenced bits (for LRU)
+  if (e.policy == ReplacementPolicy::Lru) {
+    PHASE_TIMER(e.phaseTicks, PHASE_AGING);
+    ageReferencedBits(e.JT, e.agingBits);
+  }
+
+  // Check if page is in memory
+  if (page.inMemory) {
+    PAGING_PROBE(hit, jobId, pageNum, page.pageFrameId);
+    if (e.verbose) {
+      PHASE_TIMER(e.phaseTicks, PHASE_OUTPUT);
+      printf("HIT\n");
+    }
+    e.pageHits++;
+    e.attribution.jobHits[jobId]++;
+    page.referenced |= AGING_MSB; // Set MSB on reference
+    if (e.numNodes > 1)
+      recordNumaAccess(e, jobId, pageNum);
+    return;
+  }
+
+  PAGING_PROBE(fault, jobId, pageNum);
+  if (e.verbose) {
+    PHASE_TIMER(e.phaseTicks, PHASE_OUTPUT);
+    printf("FAULT\n");
+  }
+  e.pageFaults++;
+  e.attribution.jobFaults[jobId]++;
+
+  if (e.numNodes > 1) {
+    PHASE_TIMER(e.phaseTicks, PHASE_VICTIM);
+    numaFault(e, jobId, pageNum);
+    recordNumaAccess(e, jobId, pageNum);
+    return;
+  }
+
+  // Find an empty frame
+  int emptyFrame = -1;
+  {
+    PHASE_TIMER(e.phaseTicks, PHASE_FREE_FRAME);
+    for (int i = 0; i < e.numFrames; i++) {
+      if (!e.MMT[i].busy) {
+        emptyFrame = i;
+        break;
+      }
+    }
+  }
+
+  if (emptyFrame != -1) {
+    // Load page into empty frame
+    page.pageFrameId = emptyFrame;
+    page.inMemory = true;
+    page.referenced = AGING_MSB; // Set MSB on reference
+
+    e.MMT[emptyFrame].pageNumber = pageNum;
+    e.MMT[emptyFrame].jobId = jobId;
+    e.MMT[emptyFrame].busy = true;
+
+    e.fifoQueue.push(emptyFrame);
+    e.residentPages++;
+    e.attribution.frameLoads[emptyFrame]++;
+    PAGING_PROBE(free_frame, jobId, pageNum, emptyFrame);
+    if (e.verbose) {
+      PHASE_TIMER(e.phaseTicks, PHASE_OUTPUT);
+      printf("\tLoaded F%d\n", emptyFrame);
+    }
+    return;
+  }
+
+  // Victim selection (its verbose output included)
+  PHASE_TIMER(e.phaseTicks, PHASE_VICTIM);
+  e.evictions++;
+  int frameNum = -1;
+  Eviction evicted;
+  switch (e.policy) {
+  case ReplacementPolicy::Fifo:
+    frameNum = FIFO(e.JT, e.MMT, e.fifoQueue, jobId, pageNum, e.pageSize,
+                    &evicted);
+    break;
+  case ReplacementPolicy::Lru:
+    frameNum = LRU(e.JT, e.MMT, jobId, pageNum, e.pageSize, &evicted);
+    break;
+  case ReplacementPolicy::Clock:
+    frameNum = CLOCK(e.JT, e.MMT, e.clockHand, jobId, pageNum, e.pageSize,
+                     &evicted);
+    break;
+  }
+  if (e.verbose)
+    printf("\tReplacing P%d of J%d (F%d) with P%d of J%d (%s)\n",
+           evicted.pageNumber, evicted.jobId, frameNum, pageNum, jobId,
+           policyName(e.policy));
+  e.attribution.jobEvictionsCaused[jobId]++;
+  e.attribution.jobEvictionsSuffered[evicted.jobId]++;
+  e.attribution.frameLoads[frameNum]++;
+  e.attribution.frameEvictions[frameNum]++;
+}
+
+Stats engineStats(const DemandPagingEngine &e) {
+  Stats s;
+  s.pageFrames = e.numFrames;
+  s.numAccesses = e.numAccesses;
+  s.pageFaults = e.pageFaults;
+  s.pageHits = e.pageHits;
+  s.localAccesses = e.numNodes > 1 ? e.localAccesses : e.numAccesses;
+  s.remoteAccesses = e.remoteAccesses;
+  s.migrations = e.migrations;
+  s.modeledLatencyNs =
+      NUMA_LOCAL_LATENCY_NS *
+      (s.localAccesses + e.numaRemoteCost * s.remoteAccesses);
+#ifdef PAGING_PHASE_TIMERS
+  double tickSeconds = 1 / timestampTicksPerSecond();
+  s.agingSeconds = e.phaseTicks[PHASE_AGING] * tickSeconds;
+  s.victimSeconds = e.phaseTicks[PHASE_VICTIM] * tickSeconds;
+  s.freeFrameSeconds = e.phaseTicks[PHASE_FREE_FRAME] * tickSeconds;
+  s.outputSeconds = e.phaseTicks[PHASE_OUTPUT] * tickSeconds;
+#endif
+  if (e.numAccesses > 0) {
+    s.failRatio = (double)e.pageFaults / e.numAccesses;
+    s.successRatio = (double)(e.numAccesses - e.pageFaults) / e.numAccesses;
+  }
+  return s;
+}
+
+Stats simulateDemandPagingTrace(int numFrames, int pageSize,
+                                const vector<Job> &jobs,
+                                const vector<Access> &trace,
+                                ReplacementPolicy policy, bool verbose,
+                                FaultTimeline *timeline,
+                                PerfCounters *counters, int agingBits) {
+  if (counters)
+    counters->start();
+  auto start = chrono::steady_clock::now();
+  int64_t memBefore[NUM_MEM_TAGS];
+  snapshotMemBytes(memBefore);
+  // Phase probes: 0 init, 1 accesses, 2 final report, 3 done
+  PAGING_PROBE(phase, 0, (int)policy, numFrames, (int)trace.size());
+  DemandPagingEngine e;
+  {
+    PHASE_TIMER(e.phaseTicks, PHASE_OUTPUT);
+    initEngine(e, numFrames, pageSize, jobs, policy, verbose);
+  }
+  configureAging(e, agingBits);
+  e.timeline = timeline;
+  PAGING_PROBE(phase, 1, (int)policy, numFrames, (int)trace.size());
+
+  // Simulate page requests (demand paging)
+  if (verbose) {
+    printf("\n--- Simulating Demand Paging ---\n");
+    printf("Pages are loaded into memory only when accessed.\n\n");
+  }
+  for (const auto &a : trace)
+    engineAccess(e, a.jobId, a.pageNumber);
+  finishTimeline(e);
+  PAGING_PROBE(phase, 2, (int)policy, e.pageFaults, e.pageHits);
+
+  // Print final state
+  if (verbose) {
+    PHASE_TIMER(e.phaseTicks, PHASE_OUTPUT);
+    fputs(formatMMT(e.MMT).c_str(), stdout);
+    for (const auto &kv : e.JT) {
+      printf("Final PMT for Job %d:\n", kv.first);
+      fputs(formatPMT(kv.second.PMT, true, e.agingBits).c_str(), stdout);
+    }
+  }
+
+  PAGING_PROBE(phase, 3, (int)policy, e.pageFaults, e.pageHits);
+  auto s = engineStats(e);
+  s.attribution = move(e.attribution); // The engine goes away here
+  snapshotMemBytes(s.memBytes);
+  for (int i = 0; i < NUM_MEM_TAGS; i++)
+    s.memBytes[i] -= memBefore[i];
+  for (const auto &kv : e.JT)
+    s.totalPages += (int)kv.second.PMT.size();
+  s.wallSeconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  if (counters)
+    s.perf = counters->stop();
+  s.accessesPerSec = s.wallSeconds > 0 ? s.numAccesses / s.wallSeconds : 0;
+  s.peakRssKb = peakResidentKb();
+  return s;
+}
+
+// Checkpoints: a compact binary snapshot of an engine and the generator
+// feeding it, so long runs can resume after a crash or branch from a warm
+// state. Native-endian; the format is "PGCK", a version, then the fields
+// in the order saveCheckpoint writes them. Page numbers and frame numbers
+// are implied by position, and main memory is rebuilt from the page size
+// and the NUMA node boundaries. Aging registers are stored right-aligned at
+// their width, which the header records in bits. Version 3 recorded it in
+// bytes and was always 8 bits wide, which version 4 at 8 bits matches.
+const uint32_t CHECKPOINT_VERSION = 4;
+
+struct SnapshotWriter {
+  FILE *f;
+  bool ok{true};
+};
+
+template <class T> void put(SnapshotWriter &w, const T &value) {
+  w.ok = w.ok && fwrite(&value, sizeof(T), 1, w.f) == 1;
+}
+
+// Length-prefixed array
+template <class T> void putArray(SnapshotWriter &w, const T *p, uint64_t n) {
+  put(w, n);
+  w.ok = w.ok && (n == 0 || fwrite(p, sizeof(T), n, w.f) == n);
+}
+
+struct SnapshotReader {
+  FILE *f;
+  string path;
+};
+
+template <class T> T get(SnapshotReader &r) {
+  T value;
+  if (fread(&value, sizeof(T), 1, r.f) != 1) {
+    throw runtime_error("Truncated checkpoint " + r.path);
+  }
+  return value;
+}
+
+template <class T> vector<T> getArray(SnapshotReader &r) {
+  auto n = get<uint64_t>(r);
+  vector<T> res;
+  // Grown as read, so a corrupt length fails on the data, not the allocation
+  for (uint64_t i = 0; i < n; i++)
+    res.push_back(get<T>(r));
+  return res;
+}
+
+// An aging register at its width
+void putRegister(SnapshotWriter &w, AgingRegister ref, int bits) {
+  uint64_t value = ref >> (64 - bits);
+  switch (bits) {
+  case 8:
+    put(w, (uint8_t)value);
+    break;
+  case 16:
+    put(w, (uint16_t)value);
+    break;
+  case 32:
+    put(w, (uint32_t)value);
+    break;
+  default:
+    put(w, value);
+  }
+}
+
+AgingRegister getRegister(SnapshotReader &r, int bits) {
+  uint64_t value;
+  switch (bits) {
+  case 8:
+    value = get<uint8_t>(r);
+    break;
+  case 16:
+    value = get<uint16_t>(r);
+    break;
+  case 32:
+    value = get<uint32_t>(r);
+    break;
+  default:
+    value = get<uint64_t>(r);
+  }
+  return value << (64 - bits);
+}
+
+FrameQueue queueFrom(const vector<int> &frames) {
+  FrameQueue q;
+  for (int f : frames)
+    q.push(f);
+  return q;
+}
+
+void saveCheckpoint(const string &path, const DemandPagingEngine &e,
+                    const TraceGenerator &tg, unsigned seed) {
+  string tmp = path + ".tmp";
+  SnapshotWriter w{fopen(tmp.c_str(), "wb")};
+  if (!w.f) {
+    throw runtime_error("Cannot open checkpoint file " + tmp);
+  }
+  w.ok = fwrite("PGCK", 1, 4, w.f) == 4;
+  put(w, CHECKPOINT_VERSION);
+  put(w, (uint32_t)e.agingBits);
+
+  // Configuration and counters
+  put(w, (int32_t)e.policy);
+  put(w, e.numFrames);
+  put(w, e.pageSize);
+  put(w, e.numAccesses);
+  put(w, e.pageFaults);
+  put(w, e.pageHits);
+  put(w, e.evictions);
+  put(w, e.residentPages);
+  put(w, e.clockHand);
+
+  // Page tables: per job its id, size and one packed row per page
+  put(w, (uint64_t)e.JT.size());
+  for (const auto &kv : e.JT) {
+    put(w, kv.second.id);
+    put(w, kv.second.size);
+    put(w, (uint64_t)kv.second.PMT.size());
+    for (const auto &pkv : kv.second.PMT) {
+      const auto &row = pkv.second;
+      put(w, row.pageFrameId);
+      put(w, (uint8_t)row.inMemory);
+      putRegister(w, row.referenced, e.agingBits);
+      put(w, row.remoteHits);
+    }
+  }
+
+  // Frame table
+  for (int i = 0; i < e.numFrames; i++) {
+    const auto &row = e.MMT.at(i);
+    put(w, row.jobId);
+    put(w, row.pageNumber);
+    put(w, (uint8_t)row.busy);
+  }
+  auto fifo = queueContents(e.fifoQueue);
+  putArray(w, fifo.data(), fifo.size());
+
+  // NUMA model
+  put(w, e.numNodes);
+  put(w, e.numaRemoteCost);
+  put(w, (uint8_t)e.numaBalancing);
+  putArray(w, e.nodeFirstFrame.data(), e.nodeFirstFrame.size());
+  put(w, (uint64_t)e.nodeFifo.size()); // Empty for flat memory
+  for (const auto &q : e.nodeFifo) {
+    auto frames = queueContents(q);
+    putArray(w, frames.data(), frames.size());
+  }
+  putArray(w, e.nodeClockHand.data(), e.nodeClockHand.size());
+  put(w, e.localAccesses);
+  put(w, e.remoteAccesses);
+  put(w, e.migrations);
+
+  // Attribution counters
+  const auto &a = e.attribution;
+  for (const auto *v : {&a.jobFaults, &a.jobHits, &a.jobEvictionsCaused,
+                        &a.jobEvictionsSuffered, &a.frameLoads,
+                        &a.frameEvictions})
+    putArray(w, v->data(), v->size());
+
+  // Trace generator: the RNG in its textual form, and the trace offset
+  // (accesses already serviced) is numAccesses above
+  ostringstream rng;
+  rng << tg.gen;
+  string rngState = rng.str();
+  put(w, seed);
+  putArray(w, rngState.data(), rngState.size());
+  putArray(w, tg.pagesPerJob.data(), tg.pagesPerJob.size());
+  put(w, tg.remaining);
+
+  if (fclose(w.f) != 0 || !w.ok || rename(tmp.c_str(), path.c_str()) != 0) {
+    remove(tmp.c_str());
+    throw runtime_error("Cannot write checkpoint file " + path);
+  }
+}
+
+// Throws unless every index in a loaded engine is in range and the frame
+// and page tables agree, so a damaged file cannot send the engine out of
+// bounds
+void checkCheckpoint(const DemandPagingEngine &e, const TraceGenerator &tg,
+                     const string &path) {
+  auto expect = [&](bool ok) {
+    if (!ok) {
+      throw runtime_error("Corrupt checkpoint " + path);
+    }
+  };
+  auto isFrame = [&](int f) { return f >= 0 && f < e.numFrames; };
+  expect(e.policy == ReplacementPolicy::Fifo ||
+         e.policy == ReplacementPolicy::Lru ||
+         e.policy == ReplacementPolicy::Clock);
+  expect(e.numAccesses >= 0 && e.pageFaults >= 0 && e.pageHits >= 0 &&
+         e.evictions >= 0 && isFrame(e.clockHand));
+
+  // Every resident page names a frame that holds it, and back
+  int maxJobId = -1;
+  for (const auto &kv : e.JT) {
+    expect(kv.first >= 0 && kv.second.size > 0 && !kv.second.PMT.empty());
+    maxJobId = kv.first;
+    for (const auto &pkv : kv.second.PMT) {
+      const auto &row = pkv.second;
+      if (!row.inMemory) {
+        expect(row.pageFrameId >= -1 && row.pageFrameId < e.numFrames);
+        continue;
+      }
+      expect(isFrame(row.pageFrameId));
+      const auto &frame = e.MMT.at(row.pageFrameId);
+      expect(frame.busy && frame.jobId == kv.first &&
+             frame.pageNumber == pkv.first);
+    }
+  }
+  int busy = 0;
+  for (const auto &kv : e.MMT) {
+    const auto &frame = kv.second;
+    if (!frame.busy) {
+      expect(frame.jobId >= -1);
+      continue;
+    }
+    busy++;
+    auto job = e.JT.find(frame.jobId);
+    expect(job != e.JT.end());
+    auto page = job->second.PMT.find(frame.pageNumber);
+    expect(page != job->second.PMT.end() && page->second.inMemory &&
+           page->second.pageFrameId == kv.first);
+  }
+  expect(busy == e.residentPages);
+
+  // The global FIFO order holds each resident frame at most once
+  vector<bool> queued(e.numFrames);
+  for (int f : queueContents(e.fifoQueue)) {
+    expect(isFrame(f) && e.MMT.at(f).busy && !queued[f]);
+    queued[f] = true;
+  }
+
+  // NUMA nodes split the frames into non-empty runs, their clock hands stay
+  // inside their own node and their queues hold exactly its busy frames
+  expect(e.numNodes >= 1 && e.numNodes <= e.numFrames &&
+         e.numaRemoteCost >= 1);
+  if (e.numNodes == 1) {
+    expect(e.nodeFirstFrame.empty() && e.nodeFifo.empty() &&
+           e.nodeClockHand.empty() && e.localAccesses == 0 &&
+           e.remoteAccesses == 0 && e.migrations == 0);
+  } else {
+    expect((int)e.nodeFirstFrame.size() == e.numNodes + 1 &&
+           (int)e.nodeFifo.size() == e.numNodes &&
+           (int)e.nodeClockHand.size() == e.numNodes);
+    expect(e.nodeFirstFrame[0] == 0 &&
+           e.nodeFirstFrame[e.numNodes] == e.numFrames);
+    for (int n = 0; n < e.numNodes; n++) {
+      int first = e.nodeFirstFrame[n], last = e.nodeFirstFrame[n + 1];
+      expect(first < last && e.nodeClockHand[n] >= first &&
+             e.nodeClockHand[n] < last);
+    }
+    expect(numaQueuesConsistent(e));
+    expect(e.localAccesses >= 0 && e.remoteAccesses >= 0 &&
+           e.migrations >= 0);
+  }
+
+  // Attribution is indexed by job id and frame
+  const auto &a = e.attribution;
+  for (const auto *v : {&a.jobFaults, &a.jobHits, &a.jobEvictionsCaused,
+                        &a.jobEvictionsSuffered})
+    expect((int64_t)v->size() > maxJobId &&
+           v->size() == a.jobFaults.size());
+  expect((int)a.frameLoads.size() == e.numFrames &&
+         (int)a.frameEvictions.size() == e.numFrames);
+
+  // The generator draws job ids below pagesPerJob.size() and pages below
+  // their count, all of which must exist
+  bool anyPages = false;
+  for (size_t j = 0; j < tg.pagesPerJob.size(); j++) {
+    int pages = tg.pagesPerJob[j];
+    expect(pages >= 0);
+    if (pages == 0)
+      continue;
+    anyPages = true;
+    auto job = e.JT.find((int)j);
+    expect(job != e.JT.end() && (int)job->second.PMT.size() >= pages);
+  }
+  expect(tg.remaining >= 0 && (anyPages || tg.remaining == 0));
+}
+
+unsigned loadCheckpoint(const string &path, DemandPagingEngine &e,
+                        TraceGenerator &tg) {
+  SnapshotReader r{fopen(path.c_str(), "rb"), path};
+  if (!r.f) {
+    throw runtime_error("Cannot open checkpoint file " + path);
+  }
+  unique_ptr<FILE, int (*)(FILE *)> closer(r.f, fclose);
+  char magic[4];
+  uint32_t version = 0;
+  if (fread(magic, 1, 4, r.f) != 4 || string(magic, 4) != "PGCK" ||
+      ((version = get<uint32_t>(r)) != CHECKPOINT_VERSION && version != 3)) {
+    throw runtime_error("Not a checkpoint file: " + path);
+  }
+  int agingBits = (int)get<uint32_t>(r) * (version == 3 ? 8 : 1);
+  if (!validAgingBits(agingBits)) {
+    throw runtime_error("Corrupt checkpoint " + path);
+  }
+
+  e = DemandPagingEngine();
+  e.agingBits = agingBits;
+  e.policy = (ReplacementPolicy)get<int32_t>(r);
+  e.numFrames = get<int>(r);
+  e.pageSize = get<int>(r);
+  e.numAccesses = get<int64_t>(r);
+  e.pageFaults = get<int64_t>(r);
+  e.pageHits = get<int64_t>(r);
+  e.evictions = get<int64_t>(r);
+  e.residentPages = get<int64_t>(r);
+  e.clockHand = get<int>(r);
+  if (e.numFrames <= 0 || e.pageSize <= 0) {
+    throw runtime_error("Corrupt checkpoint " + path);
+  }
+
+  // Tables are grown as read, so a corrupt count fails on the data
+  auto numJobs = get<uint64_t>(r);
+  for (uint64_t j = 0; j < numJobs; j++) {
+    int id = get<int>(r);
+    auto &job = e.JT[id];
+    job.id = id;
+    job.size = get<int>(r);
+    auto numPages = get<uint64_t>(r);
+    for (uint64_t p = 0; p < numPages; p++) {
+      PageMapTableRow row;
+      row.pageNumber = (int)p;
+      row.pageFrameId = get<int>(r);
+      row.inMemory = get<uint8_t>(r);
+      row.referenced = getRegister(r, agingBits);
+      row.remoteHits = get<uint16_t>(r);
+      job.PMT.emplace_hint(job.PMT.end(), (int)p, row);
+    }
+  }
+
+  for (int i = 0; i < e.numFrames; i++) {
+    auto &row = e.MMT[i];
+    row.pageFrameNumber = i;
+    row.jobId = get<int>(r);
+    row.pageNumber = get<int>(r);
+    row.busy = get<uint8_t>(r);
+  }
+  e.ram.resize(e.numFrames);
+  for (int i = 0; i < e.numFrames; i++) {
+    e.ram[i].id = i;
+    e.ram[i].size = e.pageSize;
+    e.ram[i].startingAddr = i * e.pageSize;
+  }
+  e.fifoQueue = queueFrom(getArray<int>(r));
+
+  e.numNodes = get<int>(r);
+  e.numaRemoteCost = get<double>(r);
+  e.numaBalancing = get<uint8_t>(r);
+  e.nodeFirstFrame = getArray<int>(r);
+  auto numNodeFifos = get<uint64_t>(r);
+  for (uint64_t n = 0; n < numNodeFifos; n++)
+    e.nodeFifo.push_back(queueFrom(getArray<int>(r)));
+  e.nodeClockHand = getArray<int>(r);
+  e.localAccesses = get<int64_t>(r);
+  e.remoteAccesses = get<int64_t>(r);
+  e.migrations = get<int64_t>(r);
+
+  auto &a = e.attribution;
+  for (auto *v : {&a.jobFaults, &a.jobHits, &a.jobEvictionsCaused,
+                  &a.jobEvictionsSuffered, &a.frameLoads, &a.frameEvictions})
+    *v = getArray<uint64_t>(r);
+
+  unsigned seed = get<unsigned>(r);
+  auto rngState = getArray<char>(r);
+  istringstream rng(string(rngState.begin(), rngState.end()));
+  rng >> tg.gen;
+  if (!rng) {
+    throw runtime_error("Corrupt checkpoint " + path);
+  }
+  tg.pagesPerJob = getArray<int>(r);
+  tg.remaining = get<int64_t>(r);
+
+  checkCheckpoint(e, tg, path);
+  if (e.numNodes > 1)
+    for (int n = 0; n < e.numNodes; n++)
+      for (int i = e.nodeFirstFrame[n]; i < e.nodeFirstFrame[n + 1]; i++)
+        e.ram[i].node = n;
+  return seed;
+}
+
+DemandPagingStream::DemandPagingStream(int numFrames, int pageSize,
+                                       ReplacementPolicy policy) {
+  if (numFrames <= 0 || pageSize <= 0) {
+    throw runtime_error("Frame count and page size must be positive!");
+  }
+  initEngine(e, numFrames, pageSize, {}, policy, false);
+  e.fifoQueue.reserve(numFrames);
+}
+
+void DemandPagingStream::addJob(const Job &job) {
+  if (job.id < 0 || job.size <= 0) {
+    throw runtime_error("Job needs a non-negative id and a positive size!");
+  }
+  if (job.id < (int)pageCount.size() && pageCount[job.id] >= 0) {
+    throw runtime_error("Job " + to_string(job.id) + " already exists!");
+  }
+  auto &row = e.JT[job.id];
+  row.id = job.id;
+  row.size = job.size;
+  row.PMT = move(divideIntoPages(job, e.pageSize).second);
+
+  if (job.id >= (int)pageCount.size()) {
+    pageCount.resize(job.id + 1, -1);
+    auto &a = e.attribution;
+    for (auto *v : {&a.jobFaults, &a.jobHits, &a.jobEvictionsCaused,
+                    &a.jobEvictionsSuffered})
+      v->resize(job.id + 1);
+  }
+  pageCount[job.id] = (int)row.PMT.size();
+}
+
+void DemandPagingStream::removeJob(int jobId) {
+  if (jobId < 0 || jobId >= (int)pageCount.size() || pageCount[jobId] < 0) {
+    throw runtime_error("No job " + to_string(jobId) + " to remove!");
+  }
+  for (const auto &pkv : e.JT[jobId].PMT) {
+    if (!pkv.second.inMemory)
+      continue;
+    auto &frame = e.MMT[pkv.second.pageFrameId];
+    frame.busy = false;
+    frame.jobId = -1;
+    frame.pageNumber = -1;
+    e.residentPages--;
+  }
+  e.JT.erase(jobId);
+  pageCount[jobId] = -1;
+
+  // Freed frames re-enter the FIFO order when they are loaded again
+  FrameQueue kept;
+  kept.reserve(e.numFrames);
+  for (; !e.fifoQueue.empty(); e.fifoQueue.pop())
+    if (e.MMT[e.fifoQueue.front()].busy)
+      kept.push(e.fifoQueue.front());
+  e.fifoQueue = move(kept);
+}
+
+void DemandPagingStream::feed(const Access *batch, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    const auto &a = batch[i];
+    if (a.jobId < 0 || a.jobId >= (int)pageCount.size() ||
+        a.pageNumber < 0 || a.pageNumber >= pageCount[a.jobId]) {
+      throw runtime_error("Access to unknown page P" +
+                          to_string(a.pageNumber) + " of J" +
+                          to_string(a.jobId));
+    }
+    engineAccess(e, a.jobId, a.pageNumber);
+  }
+}
+
+SimulationContext::SimulationContext(int maxFrames, int pageSize,
+                                     const vector<Job> &jobs)
+    : maxFrames(maxFrames), e(buildEngine(maxFrames, pageSize, jobs)) {
+  spareFrames.reserve(maxFrames);
+}
+
+void SimulationContext::reset(int numFrames, ReplacementPolicy policy) {
+  if (numFrames <= 0 || numFrames > maxFrames) {
+    throw runtime_error("Frame count must be between 1 and " +
+                        to_string(maxFrames));
+  }
+  // Pages that are not resident keep stale aging bits, which nothing
+  // reads before a load overwrites them
+  for (auto &kv : e.MMT) {
+    auto &frame = kv.second;
+    if (!frame.busy)
+      continue;
+    auto &page = e.JT.find(frame.jobId)->second.PMT.find(frame.pageNumber)
+                     ->second;
+    page.inMemory = false;
+    page.pageFrameId = -1;
+    page.referenced = 0;
+    frame.busy = false;
+    frame.jobId = -1;
+    frame.pageNumber = -1;
+  }
+
+  // The policies take the frame count from the MMT, so frames above
+  // numFrames are parked as node handles rather than freed
+  while ((int)e.MMT.size() > numFrames)
+    spareFrames.push_back(e.MMT.extract(prev(e.MMT.end())));
+  while ((int)e.MMT.size() < numFrames) {
+    e.MMT.insert(e.MMT.end(), move(spareFrames.back()));
+    spareFrames.pop_back();
+  }
+
+  while (!e.fifoQueue.empty())
+    e.fifoQueue.pop();
+  e.policy = policy;
+  e.numFrames = numFrames;
+  e.clockHand = 0;
+  e.numAccesses = e.pageFaults = e.pageHits = 0;
+  e.evictions = e.residentPages = 0;
+  fill(begin(e.phaseTicks), end(e.phaseTicks), 0);
+  auto &a = e.attribution;
+  for (auto *v : {&a.jobFaults, &a.jobHits, &a.jobEvictionsCaused,
+                  &a.jobEvictionsSuffered})
+    fill(v->begin(), v->end(), 0);
+  a.frameLoads.assign(numFrames, 0); // Within the capacity of maxFrames
+  a.frameEvictions.assign(numFrames, 0);
+}
+
+DemandPagingEngine SimulationContext::buildEngine(int maxFrames,
+                                                  int pageSize,
+                                                  const vector<Job> &jobs) {
+  if (maxFrames <= 0 || pageSize <= 0) {
+    throw runtime_error("Frame count and page size must be positive!");
+  }
+  ArenaScope scope(arena);
+  DemandPagingEngine res;
+  initEngine(res, maxFrames, pageSize, jobs, ReplacementPolicy::Fifo, false);
+  res.fifoQueue.reserve(maxFrames);
+  return res;
+}
+
+Stats simulateSweepPoint(SimulationContext &ctx, int numFrames,
+                         ReplacementPolicy policy,
+                         const vector<Access> &trace) {
+  auto start = chrono::steady_clock::now();
+  ctx.reset(numFrames, policy);
+  ctx.run(trace.data(), trace.size());
+  auto s = ctx.stats();
+  s.wallSeconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  s.accessesPerSec = s.wallSeconds > 0 ? s.numAccesses / s.wallSeconds : 0;
+  return s;
+}
+
+vector<int> flatPageOffsets(const vector<int> &pagesPerJob) {
+  vector<int> first(pagesPerJob.size() + 1);
+  for (size_t j = 0; j < pagesPerJob.size(); j++)
+    first[j + 1] = first[j] + pagesPerJob[j];
+  return first;
+}
@@ -0,0 +1,420 @@
+// Description: Demand paging engine shared by the simulator, the benchmarks
+// and the C interface: trace generation, the engine itself with its NUMA
+// model, fault timelines, checkpoints, live streams and sweep contexts.
+// Nothing is printed unless an engine is created verbose.
+//
+// Build: g++ -c engine.cpp -std=c++20 -pthread [-DPAGING_PHASE_TIMERS]
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "paging.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// A single access of a trace
+struct Access {
+  int jobId{};
+  int pageNumber{};
+};
+
+// Number of accesses generated, decoded or fanned out at a time
+const int ACCESS_BLOCK_SIZE = 4096;
+
+// Fixed-size block of accesses
+struct AccessBlock {
+  Access accesses[ACCESS_BLOCK_SIZE];
+  int count{};
+};
+
+// Streams a seeded trace of random accesses to random pages of random jobs,
+// given the page count of each job (indexed by job id)
+struct TraceGenerator {
+  std::mt19937 gen;
+  std::vector<int> pagesPerJob;
+  int64_t remaining{};
+
+  TraceGenerator(const std::vector<int> &pagesPerJob, int64_t numAccesses,
+                 unsigned seed)
+      : gen(seed), pagesPerJob(pagesPerJob), remaining(numAccesses) {}
+};
+
+// Generates the next access of the trace
+Access nextAccess(TraceGenerator &tg);
+
+// Fills a block with the next accesses; returns how many were generated
+int fillBlock(TraceGenerator &tg, AccessBlock &block);
+
+// Generates a whole seeded trace up front
+std::vector<Access> generateTrace(const std::vector<int> &pagesPerJob,
+                                  int64_t numAccesses, unsigned seed);
+
+// Page count of each job (indexed by job id)
+std::vector<int> pagesPerJob(int numJobs, int pageSize,
+                             const std::vector<Job> &jobs);
+
+// Simulator phases timed when the engine is built with -DPAGING_PHASE_TIMERS
+enum Phase {
+  PHASE_AGING,
+  PHASE_VICTIM,
+  PHASE_FREE_FRAME,
+  PHASE_OUTPUT,
+  NUM_PHASES
+};
+
+// Hardware events read around a run when perf counters are enabled
+enum PerfEvent {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_LLC_MISSES,
+  PERF_DTLB_MISSES,
+  PERF_BRANCH_MISSES,
+  NUM_PERF_EVENTS
+};
+
+extern const char *const PERF_EVENT_NAMES[NUM_PERF_EVENTS];
+
+// Event counts of one run; an event the kernel or hardware refused has
+// valid[i] false
+struct PerfSample {
+  uint64_t values[NUM_PERF_EVENTS]{};
+  bool valid[NUM_PERF_EVENTS]{};
+
+  bool any() const {
+    for (bool v : valid)
+      if (v)
+        return true;
+    return false;
+  }
+};
+
+// Set from the PAGING_PERF environment variable or bench --perf
+extern bool perfCountersEnabled;
+
+// perf_event_open counters for the calling thread, user space only so they
+// work under perf_event_paranoid 2. Each event is opened on its own, so one
+// the hardware lacks (common in VMs) does not take the others down.
+class PerfCounters {
+public:
+  PerfCounters();
+  ~PerfCounters();
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  void start();
+
+  // Stops counting and returns the counts, scaled up if the kernel had to
+  // multiplex the events
+  PerfSample stop();
+
+private:
+  int fds[NUM_PERF_EVENTS] = {-1, -1, -1, -1, -1};
+};
+
+// Per-job and per-frame counters for attributing memory pressure, in flat
+// arrays indexed by job id and frame number
+struct AttributionCounters {
+  std::vector<uint64_t> jobFaults;
+  std::vector<uint64_t> jobHits;
+  std::vector<uint64_t> jobEvictionsCaused;   // Its faults evicted another page
+  std::vector<uint64_t> jobEvictionsSuffered; // Its pages were evicted
+  std::vector<uint64_t> frameLoads;           // Pages loaded into the frame
+  std::vector<uint64_t> frameEvictions;       // Pages evicted from the frame
+};
+
+struct Stats {
+  int pageFrames{};
+  double failRatio{};
+  double successRatio{};
+  int64_t numAccesses{};
+  int64_t pageFaults{};
+  int64_t pageHits{};
+  int64_t localAccesses{};
+  int64_t remoteAccesses{};
+  int64_t migrations{};
+  double modeledLatencyNs{}; // Total modeled memory latency of all accesses
+
+  // Simulator performance; phase times stay 0 without PAGING_PHASE_TIMERS
+  double wallSeconds{};
+  double accessesPerSec{};
+  double agingSeconds{};
+  double victimSeconds{};
+  double freeFrameSeconds{};
+  double outputSeconds{};
+  long peakRssKb{};
+  PerfSample perf; // Only filled in by runs given enabled perf counters
+  // Only filled in by simulateDemandPagingTrace, which hands over its
+  // engine's counters; a longer-lived engine is read in place
+  AttributionCounters attribution;
+
+  // Bytes held by each structure at the end of the run, and the pages of all
+  // jobs, to put them per page. Exact when no other simulation runs at the
+  // same time, since the counters are process-wide.
+  int64_t memBytes[NUM_MEM_TAGS]{};
+  int totalPages{};
+};
+
+// Current bytes of every structure
+void snapshotMemBytes(int64_t bytes[NUM_MEM_TAGS]);
+
+// Counts of one window of consecutive accesses
+struct WindowSample {
+  uint32_t accesses{};
+  uint32_t faults{};
+  uint32_t hits{};
+  uint32_t evictions{};
+  uint32_t residentPages{}; // At the end of the window
+};
+
+// Fault-rate time series: one WindowSample per windowSize accesses, kept in a
+// ring preallocated up front so recording never allocates. Once the ring is
+// full the oldest windows are overwritten.
+struct FaultTimeline {
+  int windowSize{};
+  int left{};        // Accesses left in the open window
+  uint64_t closed{}; // Windows closed so far, including overwritten ones
+  std::vector<WindowSample> ring;
+
+  // Engine totals when the open window started
+  int64_t startAccesses{};
+  int64_t startFaults{};
+  int64_t startHits{};
+  int64_t startEvictions{};
+};
+
+// Default ring capacity: enough for a million windows
+const size_t TIMELINE_DEFAULT_WINDOWS = 1 << 20;
+
+void initTimeline(FaultTimeline &t, int windowSize,
+                  size_t capacity = TIMELINE_DEFAULT_WINDOWS);
+
+// Windows still in the ring, oldest first
+std::vector<WindowSample> timelineWindows(const FaultTimeline &t);
+
+// Writes the timeline as CSV, or as raw WindowSamples behind a small header
+// ("PGTL", window size, first window index, window count) if binary
+void writeTimeline(const std::string &path, const FaultTimeline &t,
+                   bool binary);
+
+// Demand paging engine for one replacement policy: owns the tables and the
+// policy state and services accesses one at a time
+struct DemandPagingEngine {
+  JobTable JT;
+  MainMemory ram;
+  MemoryMapTable MMT;
+  FrameQueue fifoQueue;
+  int clockHand{};
+  ReplacementPolicy policy{ReplacementPolicy::Fifo};
+  int agingBits{DEFAULT_AGING_BITS}; // Width of the LRU aging registers
+  int numFrames{};
+  int pageSize{};
+  int64_t numAccesses{};
+  int64_t pageFaults{};
+  int64_t pageHits{};
+  int64_t evictions{};
+  int64_t residentPages{};
+  bool verbose{};
+  uint64_t phaseTicks[NUM_PHASES]{};
+  FaultTimeline *timeline{}; // Recorded into when set
+  AttributionCounters attribution;
+
+  // NUMA model; a single node is flat memory
+  int numNodes{1};
+  double numaRemoteCost{1};
+  bool numaBalancing{};
+  std::vector<int> nodeFirstFrame; // Frames of node n: [first[n], first[n + 1])
+  std::vector<FrameQueue> nodeFifo;
+  std::vector<int> nodeClockHand;
+  int64_t localAccesses{};
+  int64_t remoteAccesses{};
+  int64_t migrations{};
+};
+
+// Divides all jobs into pages and sets up empty memory
+void initEngine(DemandPagingEngine &e, int numFrames, int pageSize,
+                const std::vector<Job> &jobs, ReplacementPolicy policy,
+                bool verbose);
+
+// Splits memory into numNodes NUMA nodes of contiguous frames. Job j lives on
+// home node j % numNodes.
+void configureNuma(DemandPagingEngine &e, int numNodes, double remoteCost,
+                   bool balancing);
+
+// Sets the width of the LRU aging registers: 8, 16, 32 or 64 bits. Safe
+// between accesses; registers narrowed mid-run lose their low bits at the
+// next aging step.
+void configureAging(DemandPagingEngine &e, int bits);
+
+// Whether every NUMA node queue holds each busy frame of its node exactly
+// once and nothing else
+bool numaQueuesConsistent(const DemandPagingEngine &e);
+
+// Services one access. Only LRU keeps aging registers; FIFO ignores them and
+// CLOCK uses the MSB as its reference bit.
+void engineAccess(DemandPagingEngine &e, int jobId, int pageNum);
+
+// Stats of everything the engine has serviced so far. Only the fixed-size
+// counters are filled in, so a query costs the same however many jobs and
+// frames there are; the attribution counters stay in e.attribution.
+Stats engineStats(const DemandPagingEngine &e);
+
+// Demand Paging Simulation over a trace of accesses. With verbose off
+// nothing is printed, which is what sweeps and benchmarks want. A timeline,
+// if given, is filled with the run's fault-rate windows, and perf counters,
+// if given, count the run into Stats::perf. Callers that measure around the
+// run themselves pass none. LRU ages agingBits-wide registers.
+Stats simulateDemandPagingTrace(int numFrames, int pageSize,
+                                const std::vector<Job> &jobs,
+                                const std::vector<Access> &trace,
+                                ReplacementPolicy policy, bool verbose,
+                                FaultTimeline *timeline = nullptr,
+                                PerfCounters *counters = nullptr,
+                                int agingBits = DEFAULT_AGING_BITS);
+
+// Checkpoints: a compact binary snapshot of an engine and the generator
+// feeding it, so long runs can resume after a crash or branch from a warm
+// state.
+
+// Writes the checkpoint to path + ".tmp" and renames it over path, so a
+// crash mid-write leaves the previous checkpoint intact
+void saveCheckpoint(const std::string &path, const DemandPagingEngine &e,
+                    const TraceGenerator &tg, unsigned seed);
+
+// Restores an engine and its generator saved by saveCheckpoint; returns the
+// seed the run started from
+unsigned loadCheckpoint(const std::string &path, DemandPagingEngine &e,
+                        TraceGenerator &tg);
+
+// Incremental simulator for live access streams: built once, then fed
+// batches of accesses, with stats available between batches and jobs
+// coming and going. Feeding does not allocate as long as every access names
+// a registered job and one of its pages.
+class DemandPagingStream {
+public:
+  DemandPagingStream(int numFrames, int pageSize, ReplacementPolicy policy);
+
+  // Registers a job; its pages start out of memory
+  void addJob(const Job &job);
+
+  // Unregisters a job and frees the frames its resident pages held
+  void removeJob(int jobId);
+
+  // Services a batch of accesses in order
+  void feed(const Access *batch, size_t n);
+
+  // Switches the replacement policy from the next access on
+  void setPolicy(ReplacementPolicy policy) { e.policy = policy; }
+
+  Stats stats() const { return engineStats(e); }
+  const DemandPagingEngine &engine() const { return e; }
+
+private:
+  DemandPagingEngine e;
+  std::vector<int> pageCount; // Pages of each job id, -1 if not registered
+};
+
+// One job mix set up once and simulated at many sweep points. Its tables
+// come from a monotonic arena, and reset() returns it to the starting state
+// (every frame free, nothing resident, counters zero) in O(frames) without
+// allocating, at any frame count up to maxFrames and under any policy.
+// Running a point and taking its stats() do not allocate either. Flat
+// memory only.
+class SimulationContext {
+public:
+  SimulationContext(int maxFrames, int pageSize, const std::vector<Job> &jobs);
+
+  void reset(int numFrames, ReplacementPolicy policy);
+
+  // Sets the LRU aging register width of the points that follow
+  void setAgingBits(int bits) { configureAging(e, bits); }
+
+  // Services accesses from the current state
+  void run(const Access *accesses, size_t n) {
+    for (size_t i = 0; i < n; i++)
+      engineAccess(e, accesses[i].jobId, accesses[i].pageNumber);
+  }
+
+  double failRatio() const {
+    return e.numAccesses > 0 ? (double)e.pageFaults / e.numAccesses : 0;
+  }
+  Stats stats() const { return engineStats(e); }
+  const DemandPagingEngine &engine() const { return e; }
+  const MonotonicArena &memory() const { return arena; }
+  int capacity() const { return maxFrames; }
+
+private:
+  // The engine's containers must be constructed inside the scope to take
+  // the arena; moving them out keeps it
+  DemandPagingEngine buildEngine(int maxFrames, int pageSize,
+                                 const std::vector<Job> &jobs);
+
+  int maxFrames;
+  MonotonicArena arena; // Declared before e, which must go first
+  DemandPagingEngine e;
+  std::vector<MemoryMapTable::node_type> spareFrames;
+};
+
+// One sweep point run on ctx over trace, timed like
+// simulateDemandPagingTrace
+Stats simulateSweepPoint(SimulationContext &ctx, int numFrames,
+                         ReplacementPolicy policy,
+                         const std::vector<Access> &trace);
+
+// One aging LRU run with registers of some width
+struct AgingRun {
+  int pageFaults{};
+  int blindEvictions{}; // Victims picked with no history left (register 0)
+  size_t registerBytes{};
+  double seconds{};
+};
+
+// First flat page number of each job, plus the total at the end
+std::vector<int> flatPageOffsets(const std::vector<int> &pagesPerJob);
+
+// Aging LRU with Counter-wide registers over a trace. Frames fill in order
+// and every access ages the registers first, as in the engine, so the
+// faults match the engine's LRU at the same register width.
+template <class Counter>
+AgingRun simulateAgingLru(int numFrames, const std::vector<int> &pagesPerJob,
+                          const std::vector<Access> &trace) {
+  auto first = flatPageOffsets(pagesPerJob);
+  std::vector<int> pageFrame(first.back(), -1);
+  std::vector<int> framePage(numFrames, -1);
+  AgingLru<Counter> lru(numFrames);
+  AgingRun res;
+  res.registerBytes = lru.bytes();
+  int usedFrames = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (const auto &a : trace) {
+    int page = first[a.jobId] + a.pageNumber;
+    lru.age();
+    int frame = pageFrame[page];
+    if (frame != -1) {
+      lru.touch(frame);
+      continue;
+    }
+    res.pageFaults++;
+    if (usedFrames < numFrames) {
+      frame = usedFrames++;
+    } else {
+      frame = lru.victim();
+      res.blindEvictions += lru.value(frame) == 0;
+      pageFrame[framePage[frame]] = -1;
+    }
+    pageFrame[page] = frame;
+    framePage[frame] = page;
+    lru.load(frame);
+  }
+  res.seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+  return res;
+}
+
+#endif
@@ -1,5 +1,5 @@
 // Description: Simulates paging memory allocation scheme
-// Compile: g++ paged.cpp -std=c++11 -o paged
+// Compile: g++ paged.cpp paging.cpp -std=c++11 -o paged
 
 #include <algorithm>
 #include <cstdio>
@@ -12,100 +12,9 @@
 #include <string>
 #include <vector>
 
-using namespace std;
-
-// Represents a job with id and size
-struct Job {
-  int id{};
-  int size{};
-};
-
-// Represents a page frame in main memory
-struct PageFrame {
-  int id{};
-  int startingAddr{};
-  int size{};
-};
-
-// Represents a page with id and size
-struct Page {
-  int id{};
-  int size{};
-};
-
-// Represents the main memory as a vector of page frames
-using MainMemory = vector<PageFrame>;
-
-// Page Map Table Row
-struct PageMapTableRow {
-  int pageNumber{};
-  int pageFrameId{};
-};
+#include "paging.h"
 
-// Page Map Table
-using PageMapTable = map<int, PageMapTableRow>;
-
-// Memory Map Table Row
-struct MemoryMapTableRow {
-  int pageFrameNumber{};
-  int pageNumber{};
-  bool busy{};
-};
-
-// Memory Map Table
-using MemoryMapTable = map<int, MemoryMapTableRow>;
-
-// Divides a job into pages of given page size and returns the pages and PMT
-pair<vector<Page>, PageMapTable> divideIntoPages(const Job &j, int pageSize) {
-  auto size = j.size;
-  vector<Page> res;
-  PageMapTable PMT;
-
-  int i{0};
-  while (size >= pageSize) {
-    Page p;
-    p.id = i;
-    p.size = pageSize;
-    res.push_back(p);
-    size -= pageSize;
-    i++;
-  }
-  if (size != 0) {
-    Page p;
-    p.id = i;
-    p.size = size;
-    res.push_back(p);
-  }
-
-  // Build PMT
-  for (const auto &page : res) {
-    PMT[page.id].pageNumber = page.id;
-    PMT[page.id].pageFrameId = -1; // Not assigned yet
-  }
-
-  return {res, PMT};
-}
-
-// Prints the Memory Map Table
-void printMMT(const MemoryMapTable &MMT) {
-  printf("MMT:\n");
-  printf("Page Frame Number\tPage Number\tBusy\n");
-  for (const auto kv : MMT) {
-    printf("%d\t\t\t%d\t\t%d\n", kv.second.pageFrameNumber,
-           kv.second.pageNumber, kv.second.busy);
-  }
-  printf("\n");
-}
-
-// Prints the Page Map Table
-void printPMT(const PageMapTable &PMT) {
-  printf("PMT:\n");
-  printf("Page Number\tPage Frame ID\n");
-  for (const auto &kv : PMT) {
-    printf("%d\t\t%d\n", kv.second.pageNumber, kv.second.pageFrameId);
-  }
-  printf("\n");
-}
+using namespace std;
 
 int main() {
   try {
@@ -146,7 +55,7 @@ int main() {
       printf("Page %d -> %d K\n", page.id, page.size);
     }
     printf("\n");
-    printPMT(PMT);
+    fputs(formatPMT(PMT, false).c_str(), stdout);
 
     // Create main memory and memory map table
     MainMemory ram;
@@ -162,7 +71,7 @@ int main() {
       MMT[i].pageNumber = -1;
       MMT[i].busy = false;
     }
-    printMMT(MMT);
+    fputs(formatMMT(MMT).c_str(), stdout);
 
     // Calculate internal fragmentation if any
     int internalFragmentation = pageSize - pages.back().size;
@@ -182,12 +91,13 @@ int main() {
       ids.pop_back();
 
       PMT[id].pageFrameId = MMT[i].pageFrameNumber;
+      PMT[id].inMemory = true;
       MMT[i].pageNumber = id;
       MMT[i].busy = true;
       i++;
     }
-    printMMT(MMT);
-    printPMT(PMT);
+    fputs(formatMMT(MMT).c_str(), stdout);
+    fputs(formatPMT(PMT, false).c_str(), stdout);
 
     // Perform address translation for 3 random addresses
     printf("Resolve 3 random address\n");
@@ -198,8 +108,7 @@ int main() {
 
       int pageNumber = addr / pageSize;
       int offset = addr % pageSize;
-      int pageFrameId = PMT[pageNumber].pageFrameId;
-      int physicalAddr = ram[pageFrameId].startingAddr + offset;
+      int physicalAddr = translateAddress(PMT, ram, addr, pageSize);
       printf("Page Number -> %d\nOffset -> %d\nPhysical Address -> %d\n",
              pageNumber, offset, physicalAddr);
       printf("\n");
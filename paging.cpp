@@ -0,0 +1,303 @@
+// Description: Paging tables, address translation and page replacement
+// policies shared by the simulators (see paging.h)
+
+#include "paging.h"
+
+#include <bitset>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+const char *const MEM_TAG_NAMES[NUM_MEM_TAGS] = {
+    "Job Table", "Page Map Tables", "Memory Map Table", "Main Memory",
+    "FIFO Queues"};
+
+MemCounter memCounters[NUM_MEM_TAGS];
+
+thread_local MonotonicArena *activeArena = nullptr;
+
+// Whatever is left of the current chunk is abandoned
+void MonotonicArena::addChunk(size_t minBytes) {
+  size_t size = minBytes > chunkBytes ? minBytes : chunkBytes;
+  chunkBytes *= 2;
+  chunks.emplace_back(new char[size]);
+  cur = chunks.back().get();
+  end = cur + size;
+  reserved += size;
+}
+
+void countAllocation(MemTag tag, int64_t bytes) {
+  auto &c = memCounters[tag];
+  int64_t now = c.bytes.fetch_add(bytes, memory_order_relaxed) + bytes;
+  int64_t peak = c.peakBytes.load(memory_order_relaxed);
+  while (now > peak && !c.peakBytes.compare_exchange_weak(
+                           peak, now, memory_order_relaxed))
+    ;
+  c.allocations.fetch_add(1, memory_order_relaxed);
+}
+
+void countDeallocation(MemTag tag, int64_t bytes) {
+  memCounters[tag].bytes.fetch_sub(bytes, memory_order_relaxed);
+}
+
+pair<vector<Page>, PageMapTable> divideIntoPages(const Job &j, int pageSize) {
+  auto size = j.size;
+  vector<Page> res;
+  PageMapTable PMT;
+
+  int i{0};
+  while (size >= pageSize) {
+    Page p;
+    p.id = i;
+    p.size = pageSize;
+    res.push_back(p);
+    size -= pageSize;
+    i++;
+  }
+  if (size != 0) {
+    Page p;
+    p.id = i;
+    p.size = size;
+    res.push_back(p);
+  }
+
+  // Build PMT
+  for (const auto &page : res) {
+    PMT[page.id].pageNumber = page.id;
+    PMT[page.id].pageFrameId = -1;
+    PMT[page.id].inMemory = false;
+    PMT[page.id].referenced = 0;
+  }
+
+  return {move(res), move(PMT)};
+}
+
+string formatMMT(const MemoryMapTable &MMT) {
+  string res = "MMT:\nPage Frame Number\tPage Number\tBusy\n";
+  char line[64];
+  for (const auto &kv : MMT) {
+    snprintf(line, sizeof(line), "%d\t\t\t%d\t\t%d\n",
+             kv.second.pageFrameNumber, kv.second.pageNumber, kv.second.busy);
+    res += line;
+  }
+  return res + "\n";
+}
+
+string formatPMT(const PageMapTable &PMT, bool showReferenced,
+                 int agingBits) {
+  string res = showReferenced
+                   ? "PMT:\nPage Number\tPage Frame ID\tReference Bit\n"
+                   : "PMT:\nPage Number\tPage Frame ID\n";
+  char line[128]; // Room for a 64-bit register
+  for (const auto &kv : PMT) {
+    if (showReferenced)
+      snprintf(line, sizeof(line), "%d\t\t%d\t\t0b%s\n",
+               kv.second.pageNumber, kv.second.pageFrameId,
+               bitset<64>(kv.second.referenced)
+                   .to_string()
+                   .substr(0, agingBits)
+                   .c_str());
+    else
+      snprintf(line, sizeof(line), "%d\t\t%d\n", kv.second.pageNumber,
+               kv.second.pageFrameId);
+    res += line;
+  }
+  return res + "\n";
+}
+
+int translateAddress(const PageMapTable &PMT, const MainMemory &ram,
+                     int logicalAddr, int pageSize) {
+  int pageNumber = logicalAddr / pageSize;
+  int offset = logicalAddr % pageSize;
+  auto it = PMT.find(pageNumber);
+  if (it == PMT.end() || !it->second.inMemory)
+    return -1;
+  int physicalAddr = ram[it->second.pageFrameId].startingAddr + offset;
+  PAGING_PROBE(translate, logicalAddr, pageNumber, it->second.pageFrameId,
+               physicalAddr);
+  return physicalAddr;
+}
+
+void ageReferencedBits(JobTable &JT, int agingBits) {
+  for (auto &kv : JT)
+    for (auto &pkv : kv.second.PMT)
+      if (pkv.second.inMemory) // Shift right one bit
+        pkv.second.referenced = agedRegister(pkv.second.referenced, agingBits);
+}
+
+const char *policyName(ReplacementPolicy policy) {
+  switch (policy) {
+  case ReplacementPolicy::Fifo:
+    return "FIFO";
+  case ReplacementPolicy::Lru:
+    return "LRU";
+  case ReplacementPolicy::Clock:
+    return "CLOCK";
+  }
+  return "?";
+}
+
+
+int FIFO(JobTable &JT, MemoryMapTable &MMT, FrameQueue &fifoQueue, int jobId,
+         int pageNum, int pageSize, Eviction *evicted) {
+  if (evicted)
+    *evicted = Eviction();
+
+  // Scenario where we have free frame: no need for replacing
+  for (auto &kv : MMT) {
+    if (!kv.second.busy) {
+      int frameNum = kv.second.pageFrameNumber;
+
+      JT[jobId].PMT[pageNum].pageFrameId = frameNum;
+      JT[jobId].PMT[pageNum].inMemory = true;
+
+      kv.second.pageNumber = pageNum;
+      kv.second.busy = true;
+      kv.second.jobId = jobId;
+
+      fifoQueue.push(frameNum);
+      PAGING_PROBE(free_frame, jobId, pageNum, frameNum);
+      return frameNum;
+    }
+  }
+
+  // If we don't have a free frame replace
+  if (fifoQueue.empty()) {
+    throw runtime_error(
+        "FIFO queue is empty — memory not initialized correctly!");
+  }
+
+  int replacedFrame = fifoQueue.front();
+  fifoQueue.pop();
+
+  int oldJobId = MMT[replacedFrame].jobId;
+  int oldPageNum = MMT[replacedFrame].pageNumber;
+  if (evicted) {
+    evicted->jobId = oldJobId;
+    evicted->pageNumber = oldPageNum;
+  }
+
+  // mark oldest out of memory
+  JT[oldJobId].PMT[oldPageNum].inMemory = false;
+  JT[oldJobId].PMT[oldPageNum].pageFrameId = -1;
+
+  PAGING_PROBE(evict, oldJobId, oldPageNum, jobId, pageNum, replacedFrame);
+
+  // Load new page into replaced frame
+  JT[jobId].PMT[pageNum].pageFrameId = replacedFrame;
+  JT[jobId].PMT[pageNum].inMemory = true;
+
+  MMT[replacedFrame].pageNumber = pageNum;
+  MMT[replacedFrame].jobId = jobId;
+  MMT[replacedFrame].busy = true;
+
+  fifoQueue.push(replacedFrame);
+
+  return replacedFrame;
+}
+
+int LRU(JobTable &JT, MemoryMapTable &MMT, int jobId, int pageNum,
+        int pageSize, Eviction *evicted) {
+  if (evicted)
+    *evicted = Eviction();
+  for (auto &kv : MMT) {
+    if (!kv.second.busy) {
+      int frameNum = kv.second.pageFrameNumber;
+
+      JT[jobId].PMT[pageNum].pageFrameId = frameNum;
+      JT[jobId].PMT[pageNum].inMemory = true;
+      JT[jobId].PMT[pageNum].referenced = AGING_MSB; // Set MSB on reference
+
+      kv.second.pageNumber = pageNum;
+      kv.second.jobId = jobId;
+      kv.second.busy = true;
+      PAGING_PROBE(free_frame, jobId, pageNum, frameNum);
+      return frameNum;
+    }
+  }
+
+  // Find the least recently used frame
+  int lruFrame = -1;
+  AgingRegister smallestRef = numeric_limits<AgingRegister>::max();
+
+  for (const auto &kv : MMT) {
+    if (kv.second.busy) {
+      int residentJobId = kv.second.jobId;
+      int residentPageNumber = kv.second.pageNumber;
+      auto ref = JT[residentJobId].PMT[residentPageNumber].referenced;
+      if (ref < smallestRef) {
+        smallestRef = JT[residentJobId].PMT[residentPageNumber].referenced;
+        lruFrame = kv.second.pageFrameNumber;
+      }
+    }
+  }
+
+  if (lruFrame == -1) {
+    throw runtime_error("LRU: No frame found for replacement!");
+  }
+
+  int oldJobId = MMT[lruFrame].jobId;
+  int oldPageNum = MMT[lruFrame].pageNumber;
+  if (evicted) {
+    evicted->jobId = oldJobId;
+    evicted->pageNumber = oldPageNum;
+  }
+
+  // Mark old page out of memory
+  JT[oldJobId].PMT[oldPageNum].inMemory = false;
+  JT[oldJobId].PMT[oldPageNum].pageFrameId = -1;
+  JT[oldJobId].PMT[oldPageNum].referenced = 0; // Clear reference
+
+  PAGING_PROBE(evict, oldJobId, oldPageNum, jobId, pageNum, lruFrame);
+
+  // Load new page into replaced frame
+  JT[jobId].PMT[pageNum].pageFrameId = lruFrame;
+  JT[jobId].PMT[pageNum].inMemory = true;
+  JT[jobId].PMT[pageNum].referenced = AGING_MSB; // Set MSB on reference
+
+  MMT[lruFrame].pageNumber = pageNum;
+  MMT[lruFrame].jobId = jobId;
+  MMT[lruFrame].busy = true;
+
+  return lruFrame;
+}
+
+int CLOCK(JobTable &JT, MemoryMapTable &MMT, int &clockHand, int jobId,
+          int pageNum, int pageSize, Eviction *evicted) {
+  int numFrames = (int)MMT.size();
+  for (int step = 0; step < 2 * numFrames; step++) {
+    int frameNum = clockHand;
+    clockHand = (clockHand + 1) % numFrames;
+
+    auto &frame = MMT[frameNum];
+    auto &resident = JT[frame.jobId].PMT[frame.pageNumber];
+    if (resident.referenced) {
+      resident.referenced = 0; // Second chance
+      continue;
+    }
+
+    int oldJobId = frame.jobId;
+    int oldPageNum = frame.pageNumber;
+    if (evicted) {
+      evicted->jobId = oldJobId;
+      evicted->pageNumber = oldPageNum;
+    }
+    resident.inMemory = false;
+    resident.pageFrameId = -1;
+
+    PAGING_PROBE(evict, oldJobId, oldPageNum, jobId, pageNum, frameNum);
+
+    // Load new page into replaced frame
+    JT[jobId].PMT[pageNum].pageFrameId = frameNum;
+    JT[jobId].PMT[pageNum].inMemory = true;
+    JT[jobId].PMT[pageNum].referenced = AGING_MSB; // Set MSB on reference
+
+    frame.pageNumber = pageNum;
+    frame.jobId = jobId;
+    frame.busy = true;
+    return frameNum;
+  }
+  throw runtime_error("CLOCK: No frame found for replacement!");
+}
@@ -0,0 +1,395 @@
+// Description: Paging tables, address translation and page replacement
+// policies shared by the simulators. No console I/O: callers print what
+// they need, using formatMMT/formatPMT for the tables.
+//
+// Build: make libpaging.a, which also holds the engine (see engine.h). This
+// header stays C++11 for paged.
+
+#ifndef PAGING_H
+#define PAGING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// USDT probes under provider "paging", for bpftrace and friends, e.g.
+//   bpftrace -e 'usdt:./demand:paging:fault { @[arg0] = count(); }'
+// They are a single nop while nothing is attached. Without <sys/sdt.h> they
+// compile to nothing.
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define PAGING_PROBE(name, ...) STAP_PROBEV(paging, name, __VA_ARGS__)
+#endif
+#endif
+#ifndef PAGING_PROBE
+#define PAGING_PROBE(name, ...)                                                \
+  do {                                                                         \
+  } while (0)
+#endif
+
+// Represent a job with id and size
+struct Job {
+  int id{};
+  int size{};
+};
+
+// Represent a page frame in main memory
+struct PageFrame {
+  int id{};
+  int startingAddr{};
+  int size{};
+  int node{}; // NUMA node the frame belongs to
+};
+
+// Represent a page with id and size
+struct Page {
+  int id{};
+  int size{};
+};
+
+// Simulator structures whose memory is accounted by CountingAllocator
+enum MemTag {
+  MEM_JOB_TABLE,
+  MEM_PAGE_MAP_TABLES,
+  MEM_MEMORY_MAP_TABLE,
+  MEM_MAIN_MEMORY,
+  MEM_FIFO_QUEUES,
+  NUM_MEM_TAGS
+};
+
+extern const char *const MEM_TAG_NAMES[NUM_MEM_TAGS];
+
+// Process-wide bytes requested by one structure's containers (allocator
+// overhead not included)
+struct MemCounter {
+  std::atomic<int64_t> bytes{};
+  std::atomic<int64_t> peakBytes{};
+  std::atomic<int64_t> allocations{};
+};
+
+extern MemCounter memCounters[NUM_MEM_TAGS];
+
+void countAllocation(MemTag tag, int64_t bytes);
+void countDeallocation(MemTag tag, int64_t bytes);
+
+// Bump allocator over chunks that double in size. Nothing is freed until
+// the arena itself goes, so whatever was built from it must go first.
+class MonotonicArena {
+public:
+  explicit MonotonicArena(size_t chunkBytes = 1 << 16)
+      : chunkBytes(chunkBytes) {}
+  MonotonicArena(const MonotonicArena &) = delete;
+  MonotonicArena &operator=(const MonotonicArena &) = delete;
+
+  void *allocate(size_t bytes, size_t align) {
+    size_t pad = (align - (size_t)cur % align) % align;
+    if (bytes + pad > (size_t)(end - cur)) {
+      addChunk(bytes + align);
+      pad = (align - (size_t)cur % align) % align;
+    }
+    void *p = cur + pad;
+    cur += pad + bytes;
+    used += bytes;
+    return p;
+  }
+
+  size_t bytesUsed() const { return used; }
+  size_t bytesReserved() const { return reserved; }
+
+private:
+  void addChunk(size_t minBytes);
+
+  std::vector<std::unique_ptr<char[]>> chunks;
+  char *cur{};
+  char *end{};
+  size_t chunkBytes;
+  size_t used{};
+  size_t reserved{};
+};
+
+// Arena that counted containers constructed on this thread take their memory
+// from, or null for the heap
+extern thread_local MonotonicArena *activeArena;
+
+// Makes arena the active one until the end of the scope
+struct ArenaScope {
+  explicit ArenaScope(MonotonicArena &arena) : saved(activeArena) {
+    activeArena = &arena;
+  }
+  ~ArenaScope() { activeArena = saved; }
+  MonotonicArena *saved;
+};
+
+// std::allocator that charges its bytes to memCounters[tag]. Containers
+// constructed inside an ArenaScope allocate from that arena and keep it when
+// moved or swapped; copies start out on the heap again.
+template <class T, MemTag tag> struct CountingAllocator {
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  template <class U> struct rebind {
+    using other = CountingAllocator<U, tag>;
+  };
+
+  CountingAllocator() : arena(activeArena) {}
+  template <class U>
+  CountingAllocator(const CountingAllocator<U, tag> &other)
+      : arena(other.arena) {}
+
+  CountingAllocator select_on_container_copy_construction() const {
+    return CountingAllocator();
+  }
+
+  T *allocate(size_t n) {
+    T *p = arena ? static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)))
+                 : std::allocator<T>().allocate(n);
+    countAllocation(tag, n * sizeof(T));
+    return p;
+  }
+  void deallocate(T *p, size_t n) {
+    countDeallocation(tag, n * sizeof(T));
+    if (!arena)
+      std::allocator<T>().deallocate(p, n);
+  }
+
+  bool operator==(const CountingAllocator &other) const {
+    return arena == other.arena;
+  }
+  bool operator!=(const CountingAllocator &other) const {
+    return arena != other.arena;
+  }
+
+  MonotonicArena *arena;
+};
+
+// Map whose nodes are charged to a MemTag
+template <class V, MemTag tag>
+using CountedMap =
+    std::map<int, V, std::less<int>,
+             CountingAllocator<std::pair<const int, V>, tag>>;
+
+// Represents the main memory as a vector of page frames
+using MainMemory =
+    std::vector<PageFrame, CountingAllocator<PageFrame, MEM_MAIN_MEMORY>>;
+
+// Aging register of a resident page (for LRU): shifted right one bit per
+// access, most significant bit set when the page is referenced. A register
+// of 8, 16, 32 or 64 bits is held left-aligned in 64, and aging drops the
+// bits past its width, so every width compares the same way. AgingLru below
+// packs registers at their width instead.
+typedef uint64_t AgingRegister;
+
+const int DEFAULT_AGING_BITS = 8;
+
+template <class Counter> constexpr Counter agingMsb() {
+  return Counter(Counter(1) << (8 * sizeof(Counter) - 1));
+}
+
+const AgingRegister AGING_MSB = agingMsb<AgingRegister>();
+
+// A register one aging step later, keeping bits bits of history
+inline AgingRegister agedRegister(AgingRegister ref, int bits) {
+  return (ref >> 1) & ~AgingRegister(0) << (64 - bits);
+}
+
+// Whether an aging register can be bits wide
+inline bool validAgingBits(int bits) {
+  return bits == 8 || bits == 16 || bits == 32 || bits == 64;
+}
+
+// Page Map Table Row
+struct PageMapTableRow {
+  int pageNumber{};
+  int pageFrameId{};
+  bool inMemory{};
+  AgingRegister referenced{};
+  uint16_t remoteHits{}; // Hits from a remote NUMA node since last balanced
+};
+
+// Page Map Table
+using PageMapTable = CountedMap<PageMapTableRow, MEM_PAGE_MAP_TABLES>;
+
+// Job Table Row
+struct JobTableRow {
+  int id{};
+  int size{};
+  PageMapTable PMT;
+};
+
+// Job Table
+using JobTable = CountedMap<JobTableRow, MEM_JOB_TABLE>;
+
+// Memory Map Table Row
+struct MemoryMapTableRow {
+  int jobId{};
+  int pageFrameNumber{};
+  int pageNumber{};
+  bool busy{};
+};
+
+// Memory Map Table
+using MemoryMapTable = CountedMap<MemoryMapTableRow, MEM_MEMORY_MAP_TABLE>;
+
+// Frame numbers in load order, for FIFO replacement. A ring that doubles
+// when full, so steady push/pop traffic never allocates (std::deque frees
+// and reallocates a block every few hundred operations).
+class FrameQueue {
+public:
+  bool empty() const { return count == 0; }
+  size_t size() const { return count; }
+  int front() const { return buf[head]; }
+
+  void push(int frame) {
+    if (count == buf.size())
+      grow();
+    size_t tail = head + count;
+    buf[tail < buf.size() ? tail : tail - buf.size()] = frame;
+    count++;
+  }
+  void pop() {
+    head = head + 1 < buf.size() ? head + 1 : 0;
+    count--;
+  }
+
+  // Drops every entry of frame, keeping the order of the others; O(size)
+  void remove(int frame) {
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+      int f = buf[(head + i) % buf.size()];
+      if (f != frame)
+        buf[(head + kept++) % buf.size()] = f;
+    }
+    count = kept;
+  }
+
+  // Capacity for n frames without further allocation
+  void reserve(size_t n) {
+    while (buf.size() < n)
+      grow();
+  }
+
+private:
+  void grow() {
+    decltype(buf) bigger(buf.empty() ? 16 : 2 * buf.size(),
+                         buf.get_allocator());
+    for (size_t i = 0; i < count; i++)
+      bigger[i] = buf[(head + i) % buf.size()];
+    buf.swap(bigger);
+    head = 0;
+  }
+
+  std::vector<int, CountingAllocator<int, MEM_FIFO_QUEUES>> buf;
+  size_t head{};
+  size_t count{};
+};
+
+// Aging LRU over one register of type Counter (uint8_t to uint64_t) per
+// frame, packed into 64-bit words so that aging shifts a whole word of
+// registers at once and narrower registers take proportionally less memory
+// and time. victim() is the frame with the smallest register, the lowest on
+// ties. Kept apart from the PMT so the width can vary without changing the
+// tables.
+template <class Counter> class AgingLru {
+  static_assert(std::is_unsigned<Counter>::value,
+                "Aging registers must be unsigned");
+
+public:
+  static const int BITS = 8 * sizeof(Counter);
+  static const int PER_WORD = 64 / BITS;
+
+  explicit AgingLru(int numFrames)
+      : numFrames(numFrames), words((numFrames + PER_WORD - 1) / PER_WORD) {}
+
+  void age() {
+    for (auto &w : words)
+      w = (w >> 1) & AGE_MASK;
+  }
+  void touch(int frame) {
+    words[frame / PER_WORD] |= (uint64_t)agingMsb<Counter>() << shift(frame);
+  }
+  void load(int frame) {
+    auto &w = words[frame / PER_WORD];
+    w = (w & ~((uint64_t)FULL << shift(frame))) |
+        (uint64_t)agingMsb<Counter>() << shift(frame);
+  }
+  int victim() const {
+    int best = 0;
+    for (int f = 0; f < numFrames && value(best) != 0; f++)
+      if (value(f) < value(best))
+        best = f;
+    return best;
+  }
+
+  Counter value(int frame) const {
+    return (Counter)(words[frame / PER_WORD] >> shift(frame));
+  }
+  size_t bytes() const { return words.size() * sizeof(uint64_t); }
+
+private:
+  static const Counter FULL = (Counter)~Counter(0);
+  // Clears the bit each register receives from its neighbour when shifted
+  static const uint64_t AGE_MASK = ~uint64_t(0) / FULL * (FULL >> 1);
+
+  static int shift(int frame) { return frame % PER_WORD * BITS; }
+
+  int numFrames;
+  std::vector<uint64_t> words;
+};
+
+// Divides a job into pages of given page size and returns the pages and PMT
+std::pair<std::vector<Page>, PageMapTable> divideIntoPages(const Job &j,
+                                                           int pageSize);
+
+// The Memory Map Table as printable text
+std::string formatMMT(const MemoryMapTable &MMT);
+
+// The Page Map Table as printable text, with each page's agingBits-wide
+// aging register if showReferenced
+std::string formatPMT(const PageMapTable &PMT, bool showReferenced,
+                      int agingBits = DEFAULT_AGING_BITS);
+
+// Translates a logical address of a job into a physical address, or -1 if
+// its page does not exist or is not in memory
+int translateAddress(const PageMapTable &PMT, const MainMemory &ram,
+                     int logicalAddr, int pageSize);
+
+// Shifts every resident page's aging register right one bit (for LRU)
+void ageReferencedBits(JobTable &JT, int agingBits = DEFAULT_AGING_BITS);
+
+// Page replacement policies
+enum class ReplacementPolicy { Fifo, Lru, Clock };
+
+const char *policyName(ReplacementPolicy policy);
+
+// The page a replacement policy evicted; jobId is -1 if it used a free frame
+struct Eviction {
+  int jobId{-1};
+  int pageNumber{-1};
+};
+
+// The policies below load page pageNum of job jobId into a free frame, or
+// else into the frame of the victim they pick, and return that frame. The
+// evicted page, if any, is stored in *evicted when given.
+
+// FIFO Replacement Algorithm
+int FIFO(JobTable &JT, MemoryMapTable &MMT, FrameQueue &fifoQueue, int jobId,
+         int pageNum, int pageSize, Eviction *evicted = nullptr);
+
+// LRU Replacement Algorithm
+int LRU(JobTable &JT, MemoryMapTable &MMT, int jobId, int pageNum,
+        int pageSize, Eviction *evicted = nullptr);
+
+// CLOCK (second chance) Replacement Algorithm; memory must be full
+int CLOCK(JobTable &JT, MemoryMapTable &MMT, int &clockHand, int jobId,
+          int pageNum, int pageSize, Eviction *evicted = nullptr);
+
+#endif